@@ -0,0 +1,156 @@
+#include "board.h"
+#include "kernels.h"
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Offline benchmark suite
+ * Runs basicSolve, minimaxMove, and higestScoredMove on every position of a corpus, and writes the results to bench_output.txt
+ * minimaxMove searches to a fixed depth on one thread, with the transposition table cleared for each position, so the moves and node
+ * counts only change when the engine does: diff them against a previous run to catch regressions (make bench-check)
+ *
+ * The corpus (corpus/v1.txt) has the same format as standin's scripts: "M N K" and then N rows of M cells (x us, o them, . empty)
+ * Corpus files are never edited. Changing the positions means a new version, so old results stay comparable
+ *
+ * bench_output.txt is tab separated, one line per position and a total line:
+ *   id m n k stones basic minimax nodes highest time_ms nps
+ * Moves are x,y (or - if none was found). time_ms covers all three, and nps is minimaxMove's nodes per second
+ * Every column before time_ms is deterministic
+ *
+ * Build: make bench
+ * Usage: bench [depth] [corpus] [c|sse2|avx2|avx512]
+ */
+
+#define BENCH_MAX_POSITIONS 1024
+#define BENCH_DEPTH 4
+#define BENCH_CORPUS "corpus/v1.txt"
+#define BENCH_OUTPUT "bench_output.txt"
+
+typedef struct {
+	bloc_t m, n, k;
+	board_t board;
+} position_t;
+
+static position_t positions[BENCH_MAX_POSITIONS];
+
+/**
+ * Read the positions of a corpus. Returns the number read, or -1 on failure */
+static int loadCorpus(const char *path) {
+	FILE *f = fopen(path, "r");
+	if(f == NULL) {
+		fprintf(stderr, "Can't open corpus %s\n", path);
+		return -1;
+	}
+	char line[256];
+	int count = 0, row = -1;
+	position_t *p = NULL;
+	while(fgets(line, sizeof(line), f)) {
+		if(line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+		if(row == -1) {
+			if(count == BENCH_MAX_POSITIONS) break;
+			p = &positions[count];
+			memset(p, 0, sizeof(position_t));
+			if(sscanf(line, "%li %li %li", &p->m, &p->n, &p->k) != 3 || p->m < 1 || p->m > 15 || p->n < 1 || p->n > 15 || p->k < 1 || p->k > 15) {
+				fprintf(stderr, "Bad position header in corpus: %s", line);
+				fclose(f);
+				return -1;
+			}
+			row = 0;
+			continue;
+		}
+		for(bloc_t x = 0; x < p->m; x++) {
+			char c = line[x];
+			if(c != 'x' && c != 'o' && c != '.') {
+				fprintf(stderr, "Bad row %i of position %i in corpus: %s", row, count + 1, line);
+				fclose(f);
+				return -1;
+			}
+			setCell(&p->board, x, row, c == 'x' ? PLAYER_US : (c == 'o' ? PLAYER_THEM : PLAYER_NONE));
+		}
+		if(++row == p->n) {
+			row = -1;
+			count++;
+		}
+	}
+	fclose(f);
+	if(row != -1) {
+		fprintf(stderr, "Corpus ends in the middle of a position\n");
+		return -1;
+	}
+	return count;
+}
+
+static double seconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Write a move as x,y, or - if found is 0 */
+static void printMove(FILE *out, int found, bloc_t x, bloc_t y) {
+	if(found) fprintf(out, "\t%li,%li", x, y);
+	else fprintf(out, "\t-");
+}
+
+int main(int argc, char **argv) {
+	int depth = argc > 1 ? strtol(argv[1], NULL, 10) : BENCH_DEPTH;
+	const char *corpus = argc > 2 ? argv[2] : BENCH_CORPUS;
+	const char *kernelSet = argc > 3 ? argv[3] : NULL;
+	int count = loadCorpus(corpus);
+	if(count < 0) return 1;
+	searchVerbose = 0;
+	if(selectKernels(kernelSet)) {
+		fprintf(stderr, "Can't use the %s kernels\n", kernelSet);
+		return 1;
+	}
+	if(ttResize(64) || setSearchThreads(1)) {
+		fprintf(stderr, "Failed to set up the search\n");
+		return 1;
+	}
+	FILE *out = fopen(BENCH_OUTPUT, "w");
+	if(out == NULL) {
+		fprintf(stderr, "Can't write %s\n", BENCH_OUTPUT);
+		return 1;
+	}
+
+	fprintf(out, "# corpus %s depth %i\n", corpus, depth);
+	fprintf(out, "# id\tm\tn\tk\tstones\tbasic\tminimax\tnodes\thighest\ttime_ms\tnps\n");
+	uint64_t totalNodes = 0;
+	double totalTime = 0, totalSearchTime = 0;
+	for(int i = 0; i < count; i++) {
+		position_t *p = &positions[i];
+		M = p->m;
+		N = p->n;
+		K = p->k;
+		board_t b;
+		memcpy(&b, &p->board, sizeof(board_t));
+		syncBoard(&b);
+		bloc_t x, y;
+		fprintf(out, "%i\t%li\t%li\t%li\t%li", i + 1, M, N, K, (bloc_t)(M * N - b.empty));
+
+		ttClear();
+		double start = seconds();
+		int found = basicSolve(&b, &x, &y);
+		printMove(out, found, x, y);
+
+		double searchStart = seconds();
+		found = minimaxMove(&b, &x, &y, depth, 0);
+		double searchTime = seconds() - searchStart;
+		totalSearchTime += searchTime;
+		printMove(out, found, x, y);
+		fprintf(out, "\t%llu", (unsigned long long)searchNodes);
+		totalNodes += searchNodes;
+
+		found = higestScoredMove(&b, &x, &y);
+		printMove(out, found, x, y);
+		double elapsed = seconds() - start;
+		totalTime += elapsed;
+		fprintf(out, "\t%.1f\t%.0f\n", elapsed * 1000, searchTime > 0 ? searchNodes / searchTime : 0);
+	}
+	fprintf(out, "total\t\t\t\t\t\t\t%llu\t\t%.1f\t%.0f\n", (unsigned long long)totalNodes, totalTime * 1000, totalSearchTime > 0 ? totalNodes / totalSearchTime : 0);
+	fclose(out);
+	printf("%s kernels, %i positions, depth %i: %llu nodes, %.3fs (%.3fs in minimax, %.0f nodes/s). Results in %s\n", kernels.name, count, depth, (unsigned long long)totalNodes,
+		totalTime, totalSearchTime, totalSearchTime > 0 ? totalNodes / totalSearchTime : 0, BENCH_OUTPUT);
+	return 0;
+}
@@ -0,0 +1,107 @@
+#include "decode.h"
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Microbenchmark for decoding /api/board responses
+ * Decodes a set of random 15x15 payloads with the fast decoder and with the generic libjson parser, and reports the throughput of each
+ * Every payload is also decoded in small chunks, and all the results are checked against each other
+ *
+ * Build: make bench_decode
+ * Usage: bench_decode [rounds]
+ */
+
+#define PAYLOAD_COUNT 64
+#define PAYLOAD_SIZE 1024
+
+static char payloads[PAYLOAD_COUNT][PAYLOAD_SIZE];
+static size_t payloadLengths[PAYLOAD_COUNT];
+
+/**
+ * Write a payload the way the server does, with a random board */
+static size_t makePayload(char *out, unsigned *seed) {
+	size_t length = sprintf(out, "{\"m\":15,\"n\":15,\"k\":5,\"board\":[");
+	for(int x = 0; x < 15; x++) {
+		out[length++] = '[';
+		for(int y = 0; y < 15; y++) {
+			*seed = *seed * 1103515245 + 12345;
+			int r = (*seed >> 16) % 4;
+			length += sprintf(out + length, "%s%i", y ? "," : "", r >= 2 ? -1 : r);
+		}
+		out[length++] = ']';
+		if(x < 14) out[length++] = ',';
+	}
+	length += sprintf(out + length, "]}");
+	return length;
+}
+
+/**
+ * Decode a payload fed in chunks of chunkSize bytes
+ * Returns nonzero on failure */
+static int decode(board_t *b, const char *payload, size_t length, size_t chunkSize, int generic) {
+	board_decoder_t dec;
+	decoderInit(&dec, b, generic);
+	for(size_t i = 0; i < length; i += chunkSize) {
+		if(decoderFeed(&dec, payload + i, length - i < chunkSize ? length - i : chunkSize)) break;
+	}
+	return decoderFinish(&dec);
+}
+
+static double seconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Decode every payload rounds times. Returns the time taken, or -1 on failure */
+static double timeDecode(int rounds, int generic) {
+	board_t b;
+	double start = seconds();
+	for(int r = 0; r < rounds; r++) {
+		for(int i = 0; i < PAYLOAD_COUNT; i++) {
+			if(decode(&b, payloads[i], payloadLengths[i], payloadLengths[i], generic)) return -1;
+		}
+	}
+	return seconds() - start;
+}
+
+int main(int argc, char **argv) {
+	int rounds = argc > 1 ? strtol(argv[1], NULL, 10) : 2000;
+	unsigned seed = 1;
+	size_t bytes = 0;
+	for(int i = 0; i < PAYLOAD_COUNT; i++) {
+		payloadLengths[i] = makePayload(payloads[i], &seed);
+		bytes += payloadLengths[i];
+	}
+
+	// the fast decoder must agree with the generic parser, however the payload is split
+	int generic = 1;
+	for(int i = 0; i < PAYLOAD_COUNT; i++) {
+		board_t fast, chunked, slow;
+		if(decode(&fast, payloads[i], payloadLengths[i], payloadLengths[i], 0)) {
+			fprintf(stderr, "Fast decoder failed on payload %i\n", i);
+			return 1;
+		}
+		if(decode(&chunked, payloads[i], payloadLengths[i], 1 + i % 7, 0) || memcmp(&fast, &chunked, sizeof(board_t))) {
+			fprintf(stderr, "Fast decoder gave a different board in chunks on payload %i\n", i);
+			return 1;
+		}
+		if(generic && decode(&slow, payloads[i], payloadLengths[i], payloadLengths[i], 1)) {
+			fprintf(stderr, "Generic parser failed, only timing the fast decoder\n");
+			generic = 0;
+		}
+		if(generic && memcmp(&fast, &slow, sizeof(board_t))) {
+			fprintf(stderr, "Fast decoder and generic parser gave different boards on payload %i\n", i);
+			return 1;
+		}
+	}
+
+	printf("decoder   boards/s      MB/s\n");
+	for(int g = 0; g <= generic; g++) {
+		double elapsed = timeDecode(rounds, g);
+		double boards = (double)rounds * PAYLOAD_COUNT;
+		printf("%-7s  %9.0f  %8.1f\n", g ? "generic" : "fast", boards / elapsed, rounds * bytes / elapsed / 1e6);
+	}
+	return 0;
+}
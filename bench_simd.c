@@ -0,0 +1,162 @@
+#include "kernels.h"
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Microbenchmark for the whole board kernels (see kernels.h)
+ * Times every set of kernels the CPU supports on random 15x15 boards, with hasRun and scoreWindows timed for every K from 3 to 15
+ * Every board is also checked to give the same results from each set as from the plain C one, with a random score table so every window's score matters
+ *
+ * Build: make bench_simd
+ * Usage: bench_simd [rounds]
+ */
+
+#define BOARD_COUNT 256
+#define SET_COUNT 4
+#define MIN_K 3
+#define MAX_K 15
+
+static const char *setNames[SET_COUNT] = {"c", "sse2", "avx2", "avx512"};
+
+static board_t boards[BOARD_COUNT];
+static int scores[256];
+
+// results of the plain C kernels, to check the others against
+static int runs[MAX_K + 1][BOARD_COUNT][2];
+static int windowScores[MAX_K + 1][BOARD_COUNT];
+static uint16_t candidates[BOARD_COUNT][16];
+static int empties[BOARD_COUNT];
+
+// nanoseconds per board for each set, by kernel and K (candidates and countEmpty don't depend on K)
+static double hasRunTimes[MAX_K + 1][SET_COUNT];
+static double scoreWindowsTimes[MAX_K + 1][SET_COUNT];
+static double candidatesTimes[SET_COUNT];
+static double countEmptyTimes[SET_COUNT];
+
+static unsigned nextRandom(unsigned *seed) {
+	*seed = *seed * 1103515245 + 12345;
+	return *seed >> 16;
+}
+
+static double seconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Run the selected set of kernels over every board with K, and compare or store the results (store is set for the plain C set)
+ * Returns nonzero if a result differs */
+static int checkKernels(int store) {
+	for(int i = 0; i < BOARD_COUNT; i++) {
+		int score = kernels.scoreWindows(&boards[i], scores);
+		if(store) windowScores[K][i] = score;
+		else if(score != windowScores[K][i]) {
+			fprintf(stderr, "%s scoreWindows differs on board %i with K %li\n", kernels.name, i, K);
+			return 1;
+		}
+		for(int p = 0; p < 2; p++) {
+			int run = kernels.hasRun(&boards[i], p);
+			if(store) runs[K][i][p] = run;
+			else if(run != runs[K][i][p]) {
+				fprintf(stderr, "%s hasRun differs on board %i player %i with K %li\n", kernels.name, i, p, K);
+				return 1;
+			}
+		}
+		uint16_t mask[16];
+		kernels.candidates(&boards[i], mask);
+		int empty = kernels.countEmpty(&boards[i]);
+		if(store) {
+			memcpy(candidates[i], mask, sizeof(mask));
+			empties[i] = empty;
+		} else if(memcmp(mask, candidates[i], sizeof(mask)) || empty != empties[i]) {
+			fprintf(stderr, "%s candidates or countEmpty differs on board %i\n", kernels.name, i);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// the timed results are summed here so the calls aren't optimized out
+static volatile int sink;
+
+/**
+ * Time one of the selected kernels (0 hasRun, 1 scoreWindows, 2 candidates, 3 countEmpty) over every board rounds times
+ * Returns nanoseconds per board */
+static double timeKernel(int kernel, int rounds) {
+	uint16_t mask[16];
+	double start = seconds();
+	for(int r = 0; r < rounds; r++) {
+		for(int i = 0; i < BOARD_COUNT; i++) {
+			if(kernel == 0) sink += kernels.hasRun(&boards[i], 0) + kernels.hasRun(&boards[i], 1);
+			else if(kernel == 1) sink += kernels.scoreWindows(&boards[i], scores);
+			else if(kernel == 2) sink += kernels.candidates(&boards[i], mask) + mask[i % 16];
+			else sink += kernels.countEmpty(&boards[i]);
+		}
+	}
+	return (seconds() - start) * 1e9 / ((double)rounds * BOARD_COUNT);
+}
+
+static void printTimes(const char *label, const double *times, const int *supported) {
+	printf("%-4s", label);
+	for(int s = 0; s < SET_COUNT; s++) {
+		if(supported[s]) printf("  %8.1f", times[s]);
+		else printf("  %8s", "-");
+	}
+	printf("\n");
+}
+
+int main(int argc, char **argv) {
+	int rounds = argc > 1 ? strtol(argv[1], NULL, 10) : 200;
+	unsigned seed = 1;
+	M = 15;
+	N = 15;
+	K = 5;
+	// boards from nearly empty to nearly full, so some have runs and some don't
+	for(int i = 0; i < BOARD_COUNT; i++) {
+		int density = i % 16;
+		for(bloc_t x = 0; x < M; x++) {
+			for(bloc_t y = 0; y < N; y++) {
+				int r = nextRandom(&seed) % 32;
+				setCell(&boards[i], x, y, r < density ? PLAYER_US : (r < 2 * density ? PLAYER_THEM : PLAYER_NONE));
+			}
+		}
+		syncBoard(&boards[i]);
+	}
+	for(int i = 0; i < 256; i++) scores[i] = (int)(nextRandom(&seed) % 2001) - 1000;
+
+	int supported[SET_COUNT];
+	for(int s = 0; s < SET_COUNT; s++) {
+		supported[s] = !selectKernels(setNames[s]);
+		if(!supported[s]) {
+			fprintf(stderr, "This CPU can't run the %s kernels\n", setNames[s]);
+			continue;
+		}
+		for(K = MIN_K; K <= MAX_K; K++) {
+			if(checkKernels(s == 0)) return 1;
+			hasRunTimes[K][s] = timeKernel(0, rounds);
+			scoreWindowsTimes[K][s] = timeKernel(1, rounds);
+		}
+		candidatesTimes[s] = timeKernel(2, rounds);
+		countEmptyTimes[s] = timeKernel(3, rounds);
+	}
+
+	printf("ns per board\n%-4s", "");
+	for(int s = 0; s < SET_COUNT; s++) printf("  %8s", setNames[s]);
+	printf("\nhasRun, by K\n");
+	char label[24];
+	for(K = MIN_K; K <= MAX_K; K++) {
+		sprintf(label, "%li", K);
+		printTimes(label, hasRunTimes[K], supported);
+	}
+	printf("scoreWindows, by K\n");
+	for(K = MIN_K; K <= MAX_K; K++) {
+		sprintf(label, "%li", K);
+		printTimes(label, scoreWindowsTimes[K], supported);
+	}
+	printf("candidates\n");
+	printTimes("", candidatesTimes, supported);
+	printf("countEmpty\n");
+	printTimes("", countEmptyTimes, supported);
+	return 0;
+}
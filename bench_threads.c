@@ -0,0 +1,181 @@
+#include "board.h"
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Benchmark for the multi-threaded minimax search
+ * Searches a fixed set of 15x15 positions (K = 5) to a fixed depth with 1, 2, 4, ... threads
+ * Reports the time taken and the speedup over one thread, and checks every thread count picks the same moves as one thread
+ *
+ * Build: make bench_threads
+ * Usage: bench_threads [depth] [max_threads] [root|lazy|ybwc]
+ * Lazy SMP can pick a different (equally good or better) move than one thread, since helpers change what thread 0 finds in the table
+ */
+
+// positions to search, with us (x) to move against them (o). Row y of each is a string of the cells (x, y)
+static const char *positions[][15] = {
+	{
+		"...............",
+		"...............",
+		"...............",
+		"x.....x........",
+		"..o....x.......",
+		"....xo.o.......",
+		".....o.xx..o...",
+		".o.x..ox.x.....",
+		".o.......o.....",
+		"......xx.......",
+		"......o........",
+		".......o.......",
+		"...............",
+		"...............",
+		"...............",
+	},
+	{
+		"...............",
+		"...............",
+		"...............",
+		"...............",
+		"...............",
+		".....o..ox.....",
+		"...............",
+		".......x.......",
+		"........o......",
+		"..........o....",
+		".........x.....",
+		".........oxx...",
+		"......x.o.x....",
+		".........o..o..",
+		"..........x....",
+	},
+	{
+		"...............",
+		"..........o....",
+		"..x..oxx.......",
+		"....xooox......",
+		".....x...o.....",
+		"......o....o...",
+		".....x.........",
+		"......ox.......",
+		"....xx.........",
+		".....o.........",
+		"...............",
+		"...............",
+		"...............",
+		"...............",
+		"...............",
+	},
+	{
+		"...............",
+		"...............",
+		"...............",
+		"..........x....",
+		"...............",
+		".........o.....",
+		"....oo.........",
+		"...xx..x.o.....",
+		"...............",
+		"...............",
+		"...............",
+		"...............",
+		"...............",
+		"...............",
+		"...............",
+	},
+	{
+		"...............",
+		"...............",
+		"...............",
+		"...oo..........",
+		"...............",
+		"......x........",
+		"......o..x.....",
+		".......x...x...",
+		"...............",
+		".........o.....",
+		"...............",
+		".......o...x...",
+		"...............",
+		"...............",
+		"...............",
+	},
+	{
+		"...............",
+		"...............",
+		"....x..........",
+		"...............",
+		"......o........",
+		"...............",
+		"........x......",
+		".......x..xo...",
+		"...............",
+		"......oo.......",
+		"...............",
+		"...............",
+		"...............",
+		"...............",
+		"...............",
+	},
+};
+#define POSITION_COUNT (sizeof(positions) / sizeof(positions[0]))
+
+static void loadPosition(board_t *b, int i) {
+	memset(b, 0, sizeof(board_t));
+	for(bloc_t y = 0; y < N; y++) {
+		for(bloc_t x = 0; x < M; x++) {
+			char c = positions[i][y][x];
+			setCell(b, x, y, c == 'x' ? PLAYER_US : (c == 'o' ? PLAYER_THEM : PLAYER_NONE));
+		}
+	}
+	syncBoard(b);
+}
+
+static double seconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+	int depth = argc > 1 ? strtol(argv[1], NULL, 10) : 4;
+	int maxThreads = argc > 2 ? strtol(argv[2], NULL, 10) : 16;
+	if(argc > 3 && setSearchMode(argv[3])) {
+		fprintf(stderr, "Unknown search mode %s\n", argv[3]);
+		return 1;
+	}
+	M = 15;
+	N = 15;
+	K = 5;
+	searchVerbose = 0;
+	if(ttResize(64)) {
+		fprintf(stderr, "Failed to allocate transposition table\n");
+		return 1;
+	}
+
+	bloc_t moves[POSITION_COUNT][2];
+	double baseTime = 0;
+	printf("threads  time(s)  speedup  moves\n");
+	for(int threads = 1; threads <= maxThreads; threads *= 2) {
+		if(setSearchThreads(threads)) {
+			fprintf(stderr, "Failed to start %i threads\n", threads);
+			return 1;
+		}
+		int same = 1;
+		double start = seconds();
+		for(unsigned i = 0; i < POSITION_COUNT; i++) {
+			board_t b;
+			bloc_t x, y;
+			loadPosition(&b, i);
+			ttClear();
+			minimaxMove(&b, &x, &y, depth, 0);
+			if(threads == 1) {
+				moves[i][0] = x;
+				moves[i][1] = y;
+			} else if(x != moves[i][0] || y != moves[i][1]) same = 0;
+		}
+		double elapsed = seconds() - start;
+		if(threads == 1) baseTime = elapsed;
+		printf("%7i  %7.3f  %7.2f  %s\n", threads, elapsed, baseTime / elapsed, same ? "same" : "DIFFERENT");
+	}
+	return 0;
+}
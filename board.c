@@ -1,4 +1,11 @@
 #include "board.h"
+#include "kernels.h"
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <assert.h>
 
 /**
  * Edward Wawrzynek
@@ -43,12 +50,31 @@
 // M, N, and K for current board to solve
 bloc_t M, N, K;
 
+// only empty cells within this distance of a stone are searched. Boards must be synced with syncBoard after it is changed
+// a radius of 2 still finds every move that makes or blocks K-1 in a row, which the threat search relies on, so it must be at least 2
+bloc_t candidateRadius = 2;
+
+// build with -DEVAL_CHECK=1 (make DEBUG=1) to check the incrementally kept evaluation and win counts against full scans of the board
+#ifndef EVAL_CHECK
+#define EVAL_CHECK 0
+#endif
+
 /**
  * prints out a board, with us as green and them as red */
 void printBoard(board_t *b) {
+	printBoardWithMove(b, -1, -1);
+}
+
+/**
+ * prints out a board, with the cell at moveX, moveY marked in blue */
+void printBoardWithMove(board_t *b, bloc_t moveX, bloc_t moveY) {
 	for(int y = 0; y < N; y++) {
 		for(int x = 0; x < M; x++) {
-			switch(b->board[x][y]) {
+			if(x == moveX && y == moveY) {
+				printf("\x1b[1;34m #\x1b[m");
+				continue;
+			}
+			switch(getCell(b, x, y)) {
 				case PLAYER_US:
 					printf("\x1b[1;32m #\x1b[m");
 					break;
@@ -58,9 +84,6 @@ void printBoard(board_t *b) {
 				case PLAYER_NONE:
 					printf(" .");
 					break;
-				case PLAYER_TIE:
-					printf("\x1b[1;34m #\x1b[m");
-					break;
 				default:
 					printf(" ?");
 			}
@@ -72,87 +95,17 @@ void printBoard(board_t *b) {
 }
 
 /**
- * Checks a board for a number of win conditions
- * Returns 1 if player1 won, 2 if player2 won, 0 if nobody won, and 4 if the board is tied */
+ * Checks a board for a number of win conditions, from its window counts
+ * Returns 1 if player1 won, 2 if player2 won, 0 if nobody won, and 4 if the board is tied (full, or with no window left that either player can win) */
 static player_t checkWin(board_t *b) {
-	// TODO: investigate using SIMD
-
-	// TODO: check if bounding loops on M and N or running all loops to 15 and allowing full unrolling has better performance
-	// check rows
-	for(bloc_t y = 0; y < N; y++) {
-		bloc_t count1 = 0;
-		bloc_t count2 = 0;
-		for(bloc_t x = 0; x < M; x++) {
-			if(b->board[x][y] & PLAYER_US) count1++;
-			else count1 = 0;
-
-			if(b->board[x][y] & PLAYER_THEM) count2++;
-			else count2 = 0;
-
-			if(count1 >= K) return PLAYER_US;
-			if(count2 >= K) return PLAYER_THEM;
-		}
-	}
-
-	// check columns 
-	for(bloc_t x = 0; x < M; x++) {
-		bloc_t count1 = 0;
-		bloc_t count2 = 0;
-		for(bloc_t y = 0; y < N; y++) {
-			if(b->board[x][y] & PLAYER_US) count1++;
-			else count1 = 0;
-
-			if(b->board[x][y] & PLAYER_THEM) count2++;
-			else count2 = 0;
-
-			if(count1 >= K) return PLAYER_US;
-			if(count2 >= K) return PLAYER_THEM;
-		}
-	}
-
-	// check diagonals
-	// check down and left diagonals
-	for(bloc_t i = 0; i < (M + N - 1); i++) {
-		bloc_t numCont1 = 0;
-		bloc_t numCont2 = 0;
-		bloc_t j = (i < M) ? 0 : (i - M + 1);
-		bloc_t z = (i < N) ? (i + 1) : N;
-		for(bloc_t y = j; y < z; y++) {
-			bloc_t x = i - y;
-
-			if(b->board[x][y] & PLAYER_US) numCont1++;
-			else numCont1 = 0;
-			if(b->board[x][y] & PLAYER_THEM) numCont2++;
-			else numCont2 = 0;
-
-			if(numCont1 >= K) return PLAYER_US;
-			if(numCont2 >= K) return PLAYER_THEM;
-		}
-	}
-	// check down and right diagonals
-	// also checks for a tie (ie -- full boards)
-	bloc_t hasEmpty = 0;
-	for(bloc_t i = 0; i < (M + N - 1); i++) {
-		bloc_t numCont1 = 0;
-		bloc_t numCont2 = 0;
-		bloc_t j = (i < N) ? (N - i - 1) : 0;
-		bloc_t z = (i < M) ? N : (M + N - i - 1);
-		for(bloc_t y = j; y < z; y++) {
-			bloc_t x = i + y - N + 1;
-
-			if(!b->board[x][y]) hasEmpty = 1;
-
-			if(b->board[x][y] & PLAYER_US) numCont1++;
-			else numCont1 = 0;
-			if(b->board[x][y] & PLAYER_THEM) numCont2++;
-			else numCont2 = 0;
-
-			if(numCont1 >= K) return PLAYER_US;
-			if(numCont2 >= K) return PLAYER_THEM;
-		}
-	}
+#if EVAL_CHECK
+	assert(!b->wins[0] == !kernels.hasRun(b, PLAYER_INDEX(PLAYER_US)));
+	assert(!b->wins[1] == !kernels.hasRun(b, PLAYER_INDEX(PLAYER_THEM)));
+#endif
+	if(b->wins[PLAYER_INDEX(PLAYER_US)]) return PLAYER_US;
+	if(b->wins[PLAYER_INDEX(PLAYER_THEM)]) return PLAYER_THEM;
 
-	return hasEmpty ? PLAYER_NONE : PLAYER_TIE;
+	return b->empty && b->live ? PLAYER_NONE : PLAYER_TIE;
 }
 
 /**
@@ -178,7 +131,7 @@ static int nextPosition(board_t *b, bloc_t *x, bloc_t *y) {
 		}
 	}
 	do {
-		if(b->board[newx][newy] == PLAYER_NONE) {
+		if(getCell(b, newx, newy) == PLAYER_NONE) {
 			*x = newx;
 			*y = newy;
 			return 1;
@@ -194,233 +147,497 @@ static int nextPosition(board_t *b, bloc_t *x, bloc_t *y) {
 }
 
 /**
- * Copy the board from src to dst and place player's stone at x, y
- */
-static void copyWithMove(board_t *dst, board_t *src, player_t player, bloc_t x, bloc_t y) {
-	memcpy(dst, src, sizeof(board_t));
-	dst->board[x][y] = player;
+ * Get the candidate moves of the position currently being examined, as a mask (a bit per cell, one uint16_t per column)
+ * Candidates are empty cells within candidateRadius of a stone. On an empty board, the center is the only candidate.
+ * If no empty cell is near a stone, every empty cell is a candidate
+ * The mask is computed once per node and walked with nextCandidate. It stays valid while moves made on b are unmade before the next one */
+static void getCandidates(board_t *b, uint16_t *mask) {
+	if(b->empty == M * N) {
+		memset(mask, 0, 16 * sizeof(uint16_t));
+		mask[M / 2] = 1u << (N / 2);
+		return;
+	}
+	kernels.candidates(b, mask);
 }
 
 /**
- * Check for obvious moves we should make
- * Run pre-minimax
- * Checks for wins, blocking wins, forking, blocking forks
- * Returns 1 and sets x and y if a move was found, 0 otherwise
+ * Get the next candidate move from a mask made by getCandidates, visiting them column by column
+ * If *x is -1, start at first position
  * 
- * x and y are clobbered no matter the result
+ * x and y are set to the next position, which is cleared from the mask
  * 
- * While minimax would detect all of these, it may miss forks if it can only run two levels deep, which it has to do on mostly empty large boards.
- */
-int basicSolve(board_t *b, bloc_t *x, bloc_t *y) {
-	// scratch boards
-	board_t s0, s1, s2;
-	bloc_t sx, sy, sx2, sy2;
-	// win if we can
-	*x = -1;
-	while(nextPosition(b, x, y)) {
-		copyWithMove(&s0, b, PLAYER_US, *x, *y);
-		if(checkWin(&s0) == PLAYER_US) return 1;
+ * return 1 if there is a next position, 0 otherwise */
+static int nextCandidate(uint16_t *mask, bloc_t *x, bloc_t *y) {
+	for(bloc_t cx = *x == -1 ? 0 : *x; cx < M; cx++) {
+		if(mask[cx]) {
+			*x = cx;
+			*y = __builtin_ctz(mask[cx]);
+			mask[cx] &= mask[cx] - 1;
+			return 1;
+		}
 	}
-	// block win
-	*x = -1;
-	while(nextPosition(b, x, y)) {
-		copyWithMove(&s0, b, PLAYER_THEM, *x, *y);
-		if(checkWin(&s0) == PLAYER_THEM) return 1;
+	return 0;
+}
+
+/**
+ * Zobrist hashing
+ * Each (player, cell) pair gets a random 64 bit key, and a board's hash is the xor of the keys of its stones
+ * Placing or removing a stone is then a single xor, so the hash is kept up to date by makeMove and unmakeMove */
+static uint64_t zobrist[2][16][16];
+// key xor'd into the hash when the minimizing player (them) is to move
+static uint64_t zobristSide;
+static int zobristReady = 0;
+
+/**
+ * splitmix64 generator, used to fill the zobrist keys with a fixed seed so hashes are the same every run */
+static uint64_t splitmix64(uint64_t *state) {
+	uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static void initZobrist() {
+	uint64_t seed = 0x6d6e6b;
+	for(int p = 0; p < 2; p++) {
+		for(int x = 0; x < 16; x++) {
+			for(int y = 0; y < 16; y++) zobrist[p][x][y] = splitmix64(&seed);
+		}
 	}
-	// fork if we can
-	*x = -1;
-	while(nextPosition(b, x, y)) {
-		copyWithMove(&s0, b, PLAYER_US, *x, *y);
-		sx = -1;
-		bloc_t winCount = 0;
-		while(nextPosition(&s0, &sx, &sy)) {
-			copyWithMove(&s1, &s0, PLAYER_US, sx, sy);
-			if(checkWin(&s1) == PLAYER_US) winCount++;
+	zobristSide = splitmix64(&seed);
+	zobristReady = 1;
+}
+
+/**
+ * Window table
+ * Every K long window along a row, column, or diagonal gets an index, and each cell has a list of the windows it is in
+ * Boards keep a count of each player's stones per window (see board_t.windows), updated for just the cell's windows on each move, so
+ * - a player has won once one of their windows holds K stones
+ * - a window is dead (can never be won) once both players have a stone in it, and a board with no live windows is a tie
+ * - a player can win in one move through a window holding K-1 of their stones and none of the opponent's
+ * The table only depends on M, N, and K, so it is built once per game by syncBoard */
+typedef struct {
+	// first cell of the window, and the direction of the rest
+	int8_t x, y, dx, dy;
+} window_t;
+
+static window_t windowList[WINDOW_MAX];
+static int windowTotal = 0;
+// the windows each cell is in (at most K per direction)
+static uint16_t cellWindows[16][16][60];
+static uint8_t cellWindowCount[16][16];
+static bloc_t windowM = 0, windowN = 0, windowK = 0;
+
+/**
+ * Window table evaluation
+ * A window with stones from both players can never be won, so it scores 0. Otherwise it scores p(p+3)/2 for the p stones in it
+ * (positive for us, negative for them), so windows closer to K in a row are worth more
+ * Scores are indexed by a window's counts as kept in board_t.windows (ours | theirs << 4), so evaluation is a lookup per window */
+static int windowScore[256];
+
+/**
+ * Build the window table and scores for the current M, N, and K */
+static void initWindows() {
+	static const bloc_t directions[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+	// counts are packed in 4 bits each, and the cell tables are 16x16
+	assert(M >= 1 && M <= 15 && N >= 1 && N <= 15 && K >= 1 && K <= 15);
+	memset(windowScore, 0, sizeof(windowScore));
+	for(int p = 1; p <= K; p++) {
+		windowScore[p] = p * (p + 3) / 2;
+		windowScore[p << 4] = -windowScore[p];
+	}
+	windowTotal = 0;
+	memset(cellWindowCount, 0, sizeof(cellWindowCount));
+	for(int d = 0; d < 4; d++) {
+		bloc_t dx = directions[d][0], dy = directions[d][1];
+		for(bloc_t x = 0; x < M; x++) {
+			for(bloc_t y = 0; y < N; y++) {
+				bloc_t endX = x + (K - 1) * dx, endY = y + (K - 1) * dy;
+				if(endX >= M || endY < 0 || endY >= N) continue;
+				windowList[windowTotal] = (window_t){x, y, dx, dy};
+				for(bloc_t i = 0; i < K; i++) {
+					bloc_t cx = x + i * dx, cy = y + i * dy;
+					cellWindows[cx][cy][cellWindowCount[cx][cy]++] = windowTotal;
+				}
+				windowTotal++;
+			}
 		}
-		if(winCount >= 2) return 1;
 	}
-	// fork if we can (incl. third level forks)
-	*x = -1;
-	while(nextPosition(b, x, y)) {
-		copyWithMove(&s0, b, PLAYER_US, *x, *y);
-		sx = -1;
-		bloc_t winCount = 0;
-		while(nextPosition(&s0, &sx, &sy)) {
-			copyWithMove(&s1, &s0, PLAYER_US, sx, sy);
-			if(checkWin(&s1) == PLAYER_US) winCount++;
+	windowM = M;
+	windowN = N;
+	windowK = K;
+}
+
+/**
+ * Evaluation score of a single stone of player's at x, y, ignoring all other stones: +1, and another +1 in the center (see evaluateBoard) */
+static inline int locationScore(bloc_t x, bloc_t y, player_t player) {
+	int score = 1 + (x >= M/3 && x < M - M/3 && y >= N/3 && y < N - N/3);
+	return player == PLAYER_US ? score : -score;
+}
+
+/**
+ * Add (add = 1) or remove (add = -1) player's stone at x, y in the counts of the windows through it
+ * The board's live, threat, and win counts and evaluation score are updated along with them */
+static void updateWindows(board_t *b, bloc_t x, bloc_t y, player_t player, int add) {
+	int p = PLAYER_INDEX(player), shift = 4 * p;
+	b->score += add * locationScore(x, y, player);
+	for(int i = 0; i < cellWindowCount[x][y]; i++) {
+		uint16_t w = cellWindows[x][y][i];
+		uint8_t before = b->windows[w];
+		uint8_t after = before + add * (1 << shift);
+		b->windows[w] = after;
+		b->score += windowScore[after] - windowScore[before];
+		int ownBefore = (before >> shift) & 15, ownAfter = (after >> shift) & 15, other = (before >> (shift ^ 4)) & 15;
+		b->wins[p] += (ownAfter == K) - (ownBefore == K);
+		// the window is dead while both players have stones in it
+		if(other) b->live += !ownAfter - !ownBefore;
+		else b->threats[p] += (ownAfter == K - 1) - (ownBefore == K - 1);
+		if(other == K - 1) b->threats[p ^ 1] += !ownAfter - !ownBefore;
+	}
+}
+
+/**
+ * Place player's stone at x, y, updating the board's incremental state
+ * Searches mutate one board with makeMove before recursing and unmakeMove after, instead of copying boards */
+static void makeMove(board_t *b, bloc_t x, bloc_t y, player_t player) {
+	updateWindows(b, x, y, player, 1);
+	b->bits[PLAYER_INDEX(player)][x] |= 1u << y;
+#if ROTATED_BOARDS
+	b->rows[PLAYER_INDEX(player)][y] |= 1u << x;
+	b->diags[PLAYER_INDEX(player)][x + y] |= 1u << x;
+	b->antiDiags[PLAYER_INDEX(player)][x - y + N - 1] |= 1u << x;
+#endif
+	b->empty--;
+	b->hash ^= zobrist[PLAYER_INDEX(player)][x][y];
+	for(bloc_t cx = (x > candidateRadius ? x - candidateRadius : 0); cx <= x + candidateRadius && cx < M; cx++) {
+		for(bloc_t cy = (y > candidateRadius ? y - candidateRadius : 0); cy <= y + candidateRadius && cy < N; cy++) {
+			if(b->near[cx][cy]++ == 0) b->nearBits[cx] |= 1u << cy;
 		}
-		if(winCount >= 2) return 1;
 	}
-	// block fork if we can TODO: if multiple forks, block the one (if any) that forces them to defend
-	*x = -1;
-	while(nextPosition(b, x, y)) {
-		copyWithMove(&s0, b, PLAYER_THEM, *x, *y);
-		sx = -1;
-		bloc_t winCount = 0;
-		while(nextPosition(&s0, &sx, &sy)) {
-			copyWithMove(&s1, &s0, PLAYER_THEM, sx, sy);
-			if(checkWin(&s1) == PLAYER_THEM) winCount++;
-		}
-		/* if we found only one direct win, check for third level fork */
-		if(winCount == 1) {
-			sx = -1;
-			while(nextPosition(&s0, &sx, &sy)) {
-				copyWithMove(&s1, &s0, PLAYER_US, sx, sy);
-				sx2 = -1;
-				bloc_t winCount2 = 0;
-				while(nextPosition(&s1, &sx2, &sy2)) {
-					copyWithMove(&s2, &s1, PLAYER_US, sx2, sy2);
-					if(checkWin(&s2) == PLAYER_US) winCount2++;
-				}
-				if(winCount2 >= 2) winCount++;
+}
+
+/**
+ * Remove the stone at x, y placed by makeMove, restoring the board's incremental state */
+static void unmakeMove(board_t *b, bloc_t x, bloc_t y) {
+	player_t player = getCell(b, x, y);
+	b->hash ^= zobrist[PLAYER_INDEX(player)][x][y];
+	b->bits[PLAYER_INDEX(player)][x] &= ~(1u << y);
+#if ROTATED_BOARDS
+	b->rows[PLAYER_INDEX(player)][y] &= ~(1u << x);
+	b->diags[PLAYER_INDEX(player)][x + y] &= ~(1u << x);
+	b->antiDiags[PLAYER_INDEX(player)][x - y + N - 1] &= ~(1u << x);
+#endif
+	updateWindows(b, x, y, player, -1);
+	b->empty++;
+	for(bloc_t cx = (x > candidateRadius ? x - candidateRadius : 0); cx <= x + candidateRadius && cx < M; cx++) {
+		for(bloc_t cy = (y > candidateRadius ? y - candidateRadius : 0); cy <= y + candidateRadius && cy < N; cy++) {
+			if(--b->near[cx][cy] == 0) b->nearBits[cx] &= ~(1u << cy);
+		}
+	}
+}
+
+// the other player (PLAYER_US <-> PLAYER_THEM)
+#define OTHER_PLAYER(p) ((p) ^ 3)
+
+/**
+ * Find the cells where player could win immediately: the empty cell of each window holding K-1 of their stones and none of the opponent's
+ * Up to max cells are stored in cx and cy, in the same order as nextCandidate. Returns the number found (stopping at max) */
+static int findWins(board_t *b, player_t player, bloc_t *cx, bloc_t *cy, int max) {
+	int p = PLAYER_INDEX(player);
+	if(!b->threats[p]) return 0;
+	uint8_t threat = (K - 1) << (4 * p);
+	uint16_t cells[16] = {0};
+	for(int w = 0, seen = 0; w < windowTotal && seen < b->threats[p]; w++) {
+		if(b->windows[w] != threat) continue;
+		seen++;
+		window_t *win = &windowList[w];
+		for(bloc_t i = 0, x = win->x, y = win->y; i < K; i++, x += win->dx, y += win->dy) {
+			if(getCell(b, x, y) == PLAYER_NONE) {
+				cells[x] |= 1u << y;
+				break;
 			}
 		}
-		if(winCount >= 2) return 1;
 	}
-	// block fork if we can (and third level fork)
-	*x = -1;
-	while(nextPosition(b, x, y)) {
-		copyWithMove(&s0, b, PLAYER_THEM, *x, *y);
-		sx = -1;
-		bloc_t winCount = 0;
-		while(nextPosition(&s0, &sx, &sy)) {
-			copyWithMove(&s1, &s0, PLAYER_THEM, sx, sy);
-			if(checkWin(&s1) == PLAYER_THEM) winCount++;
-		}
-		/* if we found only one direct win, check for third level fork */
-		if(winCount == 1) {
-			sx = -1;
-			while(nextPosition(&s0, &sx, &sy)) {
-				copyWithMove(&s1, &s0, PLAYER_THEM, sx, sy);
-				sx2 = -1;
-				bloc_t winCount2 = 0;
-				while(nextPosition(&s1, &sx2, &sy2)) {
-					copyWithMove(&s2, &s1, PLAYER_THEM, sx2, sy2);
-					if(checkWin(&s2) == PLAYER_THEM) winCount2++;
+	int found = 0;
+	for(bloc_t x = 0; x < M && found < max; x++) {
+		for(; cells[x] && found < max; cells[x] &= cells[x] - 1) {
+			cx[found] = x;
+			cy[found] = __builtin_ctz(cells[x]);
+			found++;
+		}
+	}
+	return found;
+}
+
+/**
+ * Mark the empty cells (other than x, y) of every K long window through x, y that has none of the opponent's stones and exactly count of player's stones
+ * Cells are or'd into mask (a bit per cell, one uint16_t per column). Returns the number of windows found
+ * 
+ * With count = K-2 and a stone about to be placed at x, y, the marked cells are the cells where player would then win */
+static int windowCells(board_t *b, player_t player, bloc_t x, bloc_t y, bloc_t count, uint16_t *mask) {
+	if(count < 0) return 0;
+	uint8_t want = count << (4 * PLAYER_INDEX(player));
+	int windows = 0;
+	for(int i = 0; i < cellWindowCount[x][y]; i++) {
+		uint16_t w = cellWindows[x][y][i];
+		if(b->windows[w] != want) continue;
+		windows++;
+		window_t *win = &windowList[w];
+		for(bloc_t j = 0, cx = win->x, cy = win->y; j < K; j++, cx += win->dx, cy += win->dy) {
+			if((cx != x || cy != y) && getCell(b, cx, cy) == PLAYER_NONE) mask[cx] |= 1u << cy;
+		}
+	}
+	return windows;
+}
+
+/**
+ * Threat space search
+ * 
+ * Instead of searching every move, the attacker only plays threats, which the defender must answer:
+ * - a four: a move leaving K-1 of the attacker's stones in a window with one empty cell. The defender's only answer is that cell
+ * - a three (when vct is set): a move after which the attacker has a move making two fours at once. The defender answers by taking one of those moves or one of the cells they would threaten, or by making a four of their own
+ * A move making two fours at once wins, as the defender can only block one
+ * 
+ * Restricting the attacker to threats keeps the tree narrow enough to find wins many moves deep
+ * Searching fours only (vct = 0) is a victory by continuous fours (VCF). Adding threes gives a victory by continuous threats (VCT)
+ * Defender's fours are answered, but the attacker only carries on if the answer is itself a threat, so a win found is always forced
+ */
+
+// most nodes a single threat search may visit, and how many attacker moves deep it goes
+#define VCF_MAX_NODES 20000
+#define VCF_DEPTH 12
+#define VCT_MAX_NODES 20000
+#define VCT_DEPTH 4
+
+typedef struct {
+	uint64_t nodes;
+	uint64_t maxNodes;
+	// cells played by either side in the forced win found (a bit per cell, one uint16_t per column)
+	uint16_t line[16];
+} threat_t;
+
+/**
+ * Search for a forced win for attacker (who is to move) using only threats
+ * depth is the number of attacker moves left. vct is nonzero to allow threes as well as fours
+ * Returns 1 and sets x and y to the first move if a win was found, 0 if none was found (or the node limit was reached) */
+static int threatSearch(threat_t *t, board_t *b, player_t attacker, int depth, int vct, bloc_t *x, bloc_t *y) {
+	player_t defender = OTHER_PLAYER(attacker);
+	bloc_t sx, sy;
+	if(++t->nodes > t->maxNodes) return 0;
+	// win now if we can
+	if(findWins(b, attacker, x, y, 1)) {
+		t->line[*x] |= 1u << *y;
+		return 1;
+	}
+	if(depth == 0) return 0;
+	// if the defender threatens to win, the attacker has to block, and can only carry on if the block is also a threat
+	bloc_t blockX[2], blockY[2];
+	int defenderWins = findWins(b, defender, blockX, blockY, 2);
+	if(defenderWins >= 2) return 0;
+
+	bloc_t mx = -1, my;
+	uint16_t candidates[16];
+	if(!defenderWins) getCandidates(b, candidates);
+	while(defenderWins ? mx == -1 : nextCandidate(candidates, &mx, &my)) {
+		if(defenderWins) {
+			mx = blockX[0];
+			my = blockY[0];
+		}
+		int result = 0;
+		uint16_t wins[16] = {0};
+		if(windowCells(b, attacker, mx, my, K - 2, wins)) {
+			// a four, or two at once
+			makeMove(b, mx, my, attacker);
+			bloc_t winCount = 0, winX = -1, winY = -1;
+			for(bloc_t cx = 0; cx < M; cx++) {
+				if(wins[cx]) {
+					winCount += __builtin_popcount(wins[cx]);
+					winX = cx;
+					winY = __builtin_ctz(wins[cx]);
+				}
+			}
+			if(winCount >= 2) {
+				result = 1;
+				for(bloc_t cx = 0; cx < M; cx++) t->line[cx] |= wins[cx];
+			} else {
+				makeMove(b, winX, winY, defender);
+				result = threatSearch(t, b, attacker, depth - 1, vct, &sx, &sy);
+				unmakeMove(b, winX, winY);
+				if(result) t->line[winX] |= 1u << winY;
+			}
+			unmakeMove(b, mx, my);
+		} else if(vct && K >= 3) {
+			uint16_t threes[16] = {0};
+			if(windowCells(b, attacker, mx, my, K - 3, threes)) {
+				makeMove(b, mx, my, attacker);
+				// find the attacker's double fours, and the cells the defender can answer with
+				uint16_t answers[16] = {0};
+				int doubleFours = 0;
+				for(bloc_t cx = 0; cx < M; cx++) {
+					for(uint16_t cells = threes[cx]; cells; cells &= cells - 1) {
+						bloc_t cy = __builtin_ctz(cells);
+						uint16_t fours[16] = {0};
+						windowCells(b, attacker, cx, cy, K - 2, fours);
+						bloc_t fourCount = 0;
+						for(bloc_t fx = 0; fx < M; fx++) fourCount += __builtin_popcount(fours[fx]);
+						if(fourCount < 2) continue;
+						doubleFours = 1;
+						answers[cx] |= 1u << cy;
+						for(bloc_t fx = 0; fx < M; fx++) answers[fx] |= fours[fx];
+					}
+				}
+				if(doubleFours) {
+					// the defender may also answer with a four of their own
+					bloc_t dx = -1, dy;
+					uint16_t replies[16];
+					getCandidates(b, replies);
+					while(nextCandidate(replies, &dx, &dy)) {
+						uint16_t scratch[16] = {0};
+						if(windowCells(b, defender, dx, dy, K - 2, scratch)) answers[dx] |= 1u << dy;
+					}
+					// the attacker wins only if every answer still loses
+					result = 1;
+					for(bloc_t ax = 0; ax < M && result; ax++) {
+						for(uint16_t cells = answers[ax]; cells && result; cells &= cells - 1) {
+							bloc_t ay = __builtin_ctz(cells);
+							makeMove(b, ax, ay, defender);
+							result = threatSearch(t, b, attacker, depth - 1, vct, &sx, &sy);
+							unmakeMove(b, ax, ay);
+						}
+					}
+					if(result) {
+						for(bloc_t ax = 0; ax < M; ax++) t->line[ax] |= answers[ax];
+					}
 				}
-				if(winCount2 >= 2) winCount++;
+				unmakeMove(b, mx, my);
 			}
 		}
-		if(winCount >= 2) return 1;
+		if(result) {
+			t->line[mx] |= 1u << my;
+			*x = mx;
+			*y = my;
+			return 1;
+		}
+		if(t->nodes > t->maxNodes) return 0;
+	}
+	return 0;
+}
+
+/**
+ * Run a threat search for attacker (to move) from scratch
+ * If line is not NULL, the cells used by the win found are stored in it */
+static int threatSolve(board_t *b, player_t attacker, int vct, bloc_t *x, bloc_t *y, uint16_t *line) {
+	threat_t t;
+	memset(&t, 0, sizeof(threat_t));
+	t.maxNodes = vct ? VCT_MAX_NODES : VCF_MAX_NODES;
+	int found = threatSearch(&t, b, attacker, vct ? VCT_DEPTH : VCF_DEPTH, vct, x, y);
+	if(found && line != NULL) memcpy(line, t.line, sizeof(t.line));
+	return found;
+}
+
+/**
+ * Find a move that stops the opponent's forced win, given the cells used by one of their wins
+ * Only moves on their winning line, or fours of our own (which they have to answer), are tried
+ * Returns 1 and sets x and y if a defence was found. Otherwise, x and y are set to their first move and 0 is returned */
+static int defendThreats(board_t *b, int vct, uint16_t *line, bloc_t themX, bloc_t themY, bloc_t *x, bloc_t *y) {
+	bloc_t sx, sy;
+	uint16_t candidates[16];
+	getCandidates(b, candidates);
+	*x = -1;
+	while(nextCandidate(candidates, x, y)) {
+		uint16_t scratch[16] = {0};
+		if(!((line[*x] >> *y) & 1) && !windowCells(b, PLAYER_US, *x, *y, K - 2, scratch)) continue;
+		makeMove(b, *x, *y, PLAYER_US);
+		int lost = threatSolve(b, PLAYER_THEM, vct, &sx, &sy, NULL);
+		unmakeMove(b, *x, *y);
+		if(!lost) return 1;
 	}
-	
+	*x = themX;
+	*y = themY;
+	return 0;
+}
+
+/**
+ * Check for obvious moves we should make
+ * Run pre-minimax
+ * Checks for wins, blocking wins, and forced wins for either side found by threat space search (see threatSearch)
+ * Returns 1 and sets x and y if a move was found, 0 otherwise
+ * 
+ * x and y are clobbered no matter the result
+ * b is modified during the search, but is restored before returning
+ * 
+ * While minimax would detect all of these, it may miss forced wins if it can only run a few levels deep, which it has to do on mostly empty large boards.
+ */
+int basicSolve(board_t *b, bloc_t *x, bloc_t *y) {
+	uint16_t line[16];
+	bloc_t themX, themY;
+	// win if we can
+	if(findWins(b, PLAYER_US, x, y, 1)) return 1;
+	// block win
+	if(findWins(b, PLAYER_THEM, x, y, 1)) return 1;
+	// win with continuous fours
+	if(threatSolve(b, PLAYER_US, 0, x, y, NULL)) return 1;
+	// stop their continuous fours
+	if(threatSolve(b, PLAYER_THEM, 0, &themX, &themY, line)) {
+		defendThreats(b, 0, line, themX, themY, x, y);
+		return 1;
+	}
+	// win with continuous threats
+	if(threatSolve(b, PLAYER_US, 1, x, y, NULL)) return 1;
+	// stop their continuous threats
+	if(threatSolve(b, PLAYER_THEM, 1, &themX, &themY, line)) {
+		defendThreats(b, 1, line, themX, themY, x, y);
+		return 1;
+	}
+
 	return 0;
 }
 
 /**
  * Board evaluation function for minimax.
- * Pieces in the center of the board (TODO: how to define) are worth +2, edges +1
- * For each row, column, or diagonal uninterrupted by the enemy's stones for at least K long, each piece adds +2, and is increased by 1 after each piece
+ * Every stone is worth +1, and stones in the center of the board are worth another +1
+ * Every K long window along a row, column, or diagonal without the enemy's stones is worth p(p+3)/2 for the p pieces in it (see windowScore)
  * 
- * So one piece in an empty row of K is +2, two pieces is +5 (2+3), three is +9 (2+3+4), etc
+ * So one piece in an empty window is +2, two pieces is +5 (2+3), three is +9 (2+3+4), etc
  * 
  * Basically
  * - Having a potential winning row/col/diag is good, and is given a better score the closer it is to winning
  * - Being in the center is also good
  */
 
-// Preprocessor abuse
-#define EVAL_COUNTERS_DECL() 			\
-/* Player 1 counters */						\
-/* how long the run has gone */		\
-bloc_t runLen1 = 0;								\
-/* how many stones in the run */	\
-bloc_t pieces1 = 0;								\
-/* current score of run */				\
-bloc_t runScore1 = 0;							\
-bloc_t runLen2 = 0;								\
-bloc_t pieces2 = 0;								\
-bloc_t runScore2 = 0;
-
-#define EVAL_END_RUN() 										\
-if(runLen2 >= K) finalScore -= runScore2; \
-if(runLen1 >= K) finalScore += runScore1;
-
-#define EVAL_RUN_BODY() 											\
-if(b->board[x][y] & PLAYER_US) {							\
-	pieces1++;																	\
-	runScore1 += pieces1 + 1;										\
-	runLen1++;																	\
-	/* this ends a PLAYER_THEM run */						\
-	if(runLen2 >= K) finalScore -= runScore2;		\
-	runLen2 = 0;																\
-	runScore2 = 0;															\
-	pieces2 = 0;																\
-} else if(b->board[x][y] & PLAYER_THEM) {			\
-	pieces2++;																	\
-	runScore2 += pieces2 + 1;										\
-	runLen2++;																	\
-	/* this ends a PLAYER_US run */							\
-	if(runLen1 >= K) finalScore += runScore1;		\
-	runLen1 = 0;																\
-	runScore1 = 0;															\
-	pieces1 = 0;																\
-} else {																			\
-	runLen1++;																	\
-	runLen2++;																	\
-}
-
-static int evaluateBoard(board_t *b) {
+/**
+ * Score a board from scratch. syncBoard stores this in the board, and makeMove and unmakeMove keep it up to date */
+static int scoreBoard(board_t *b) {
 	int finalScore = 0;
 	/** score piece location **/
 	/** center is defined as M/3 < x < 2*M/3, N/3 < y < 2*N/3 **/
+	/** every stone is worth 1, and stones in the center are worth another 1 **/
+	uint16_t centerRows = ((1u << (N - (N/3))) - 1) & ~((1u << (N/3)) - 1);
 	for(bloc_t x = 0; x < M; x++) {
-		for(bloc_t y = 0; y < N; y++) {
-			int value = (x >= (M/3) && x < (M - (M/3)) && y >= (N/3) && y < (N - (N/3))) ? 2 : 1;
-			if(b->board[x][y] & PLAYER_US) finalScore += value;
-			else if(b->board[x][y] & PLAYER_THEM) finalScore -= value;
-		}
+		uint16_t us = b->bits[PLAYER_INDEX(PLAYER_US)][x];
+		uint16_t them = b->bits[PLAYER_INDEX(PLAYER_THEM)][x];
+		finalScore += __builtin_popcount(us) - __builtin_popcount(them);
+		if(x >= (M/3) && x < (M - (M/3))) finalScore += __builtin_popcount(us & centerRows) - __builtin_popcount(them & centerRows);
 	}
 
 	/** score pieces in relation to each other **/
-
-	/** --- SCORE ROWS --- **/
-	for(bloc_t y = 0; y < N; y++) {
-		EVAL_COUNTERS_DECL();
-		for(bloc_t x = 0; x < M; x++) {
-			EVAL_RUN_BODY();
-		}
-		EVAL_END_RUN();
-	}
-
-	/** --- SCORE COLUMNS --- **/
-	for(bloc_t x = 0; x < M; x++) {
-		EVAL_COUNTERS_DECL();
-		for(bloc_t y = 0; y < N; y++) {
-			EVAL_RUN_BODY();
-		}
-		EVAL_END_RUN();
-	}
-
-	/** --- SCORE DIAGONALS --- **/
-	// check down and left diagonals
-	for(bloc_t i = 0; i < (M + N - 1); i++) {
-		bloc_t j = (i < M) ? 0 : (i - M + 1);
-		bloc_t z = (i < N) ? (i + 1) : N;
-
-		EVAL_COUNTERS_DECL();
-		for(bloc_t y = j; y < z; y++) {
-			bloc_t x = i - y;
-
-			EVAL_RUN_BODY();
-		}
-		EVAL_END_RUN();
-	}
-	// score down and right diagonals
-	for(bloc_t i = 0; i < (M + N - 1); i++) {
-		bloc_t j = (i < N) ? (N - i - 1) : 0;
-		bloc_t z = (i < M) ? N : (M + N - i - 1);
-		EVAL_COUNTERS_DECL();
-		for(bloc_t y = j; y < z; y++) {
-			bloc_t x = i + y - N + 1;
-			EVAL_RUN_BODY();
-		}
-		EVAL_END_RUN();
-	}
+	finalScore += kernels.scoreWindows(b, windowScore);
 
 	return finalScore;
 }
 
+/**
+ * Evaluate a board, which is kept up to date as moves are made */
+static int evaluateBoard(board_t *b) {
+#if EVAL_CHECK
+	assert(b->score == scoreBoard(b));
+#endif
+	// windows overlap, so a crowded board can add up past the range the search treats as evaluations
+	if(b->score > EVAL_MAX) return EVAL_MAX;
+	if(b->score < EVAL_MIN) return EVAL_MIN;
+	return b->score;
+}
+
 /**
  * Pick the first legal move as a back up in case other methods fail */
 int backUpMove(board_t *b, bloc_t *x, bloc_t *y) {
@@ -433,12 +650,14 @@ int backUpMove(board_t *b, bloc_t *x, bloc_t *y) {
 int higestScoredMove(board_t *b, bloc_t *x, bloc_t *y) {
 	int maxScore = EVAL_N_INF;
 	bloc_t max_x = -1, max_y = -1;
-	board_t scratch;
 
+	uint16_t candidates[16];
+	getCandidates(b, candidates);
 	*x = -1;
-	while(nextPosition(b, x, y)) {
-		copyWithMove(&scratch, b, PLAYER_US, *x, *y);
-		int score = evaluateBoard(&scratch);
+	while(nextCandidate(candidates, x, y)) {
+		makeMove(b, *x, *y, PLAYER_US);
+		int score = evaluateBoard(b);
+		unmakeMove(b, *x, *y);
 		if(score > maxScore) {
 			maxScore = score;
 			max_x = *x;
@@ -455,13 +674,72 @@ int higestScoredMove(board_t *b, bloc_t *x, bloc_t *y) {
  * Count the number of empty cells in a board
  */
 int countEmpty(board_t *b) {
-	int res = 0;
-	for(int x = 0; x < M; x++) {
-		for(int y = 0; y< N; y++) {
-			if(b->board[x][y] == PLAYER_NONE) res++;
+	return kernels.countEmpty(b);
+}
+
+/**
+ * Recompute the incrementally maintained parts of a board (rotated copies, empty cell count, evaluation score, window counts, hash, candidate moves) from its cells
+ * Must be called after a board's cells are set directly with setCell */
+void syncBoard(board_t *b) {
+	if(!zobristReady) initZobrist();
+	if(kernels.name == NULL) selectKernels(NULL);
+	if(windowM != M || windowN != N || windowK != K) initWindows();
+#if ROTATED_BOARDS
+	memset(b->rows, 0, sizeof(b->rows));
+	memset(b->diags, 0, sizeof(b->diags));
+	memset(b->antiDiags, 0, sizeof(b->antiDiags));
+	for(int p = 0; p < 2; p++) {
+		for(bloc_t x = 0; x < M; x++) {
+			for(uint16_t column = b->bits[p][x]; column; column &= column - 1) {
+				bloc_t y = __builtin_ctz(column);
+				b->rows[p][y] |= 1u << x;
+				b->diags[p][x + y] |= 1u << x;
+				b->antiDiags[p][x - y + N - 1] |= 1u << x;
+			}
+		}
+	}
+#endif
+	b->empty = countEmpty(b);
+	b->score = scoreBoard(b);
+	// count each window's stones, and which windows are live, threats, or wins
+	b->live = 0;
+	memset(b->threats, 0, sizeof(b->threats));
+	memset(b->wins, 0, sizeof(b->wins));
+	for(int w = 0; w < windowTotal; w++) {
+		window_t *win = &windowList[w];
+		int count[2] = {0, 0};
+		for(bloc_t i = 0, x = win->x, y = win->y; i < K; i++, x += win->dx, y += win->dy) {
+			count[0] += (b->bits[0][x] >> y) & 1;
+			count[1] += (b->bits[1][x] >> y) & 1;
+		}
+		b->windows[w] = count[0] | count[1] << 4;
+		b->live += !count[0] || !count[1];
+		for(int p = 0; p < 2; p++) {
+			b->threats[p] += count[p] == K - 1 && !count[p ^ 1];
+			b->wins[p] += count[p] == K;
+		}
+	}
+	memset(b->near, 0, sizeof(b->near));
+	memset(b->nearBits, 0, sizeof(b->nearBits));
+	for(bloc_t x = 0; x < M; x++) {
+		for(bloc_t y = 0; y < N; y++) {
+			if(getCell(b, x, y) == PLAYER_NONE) continue;
+			for(bloc_t cx = (x > candidateRadius ? x - candidateRadius : 0); cx <= x + candidateRadius && cx < M; cx++) {
+				for(bloc_t cy = (y > candidateRadius ? y - candidateRadius : 0); cy <= y + candidateRadius && cy < N; cy++) {
+					if(b->near[cx][cy]++ == 0) b->nearBits[cx] |= 1u << cy;
+				}
+			}
+		}
+	}
+	// M, N, and K are mixed into the hash so transposition table entries from other games never match
+	uint64_t dims = ((uint64_t)M << 16) | ((uint64_t)N << 8) | (uint64_t)K;
+	b->hash = splitmix64(&dims);
+	for(bloc_t x = 0; x < M; x++) {
+		for(bloc_t y = 0; y < N; y++) {
+			player_t cell = getCell(b, x, y);
+			if(cell != PLAYER_NONE) b->hash ^= zobrist[PLAYER_INDEX(cell)][x][y];
 		}
 	}
-	return res;
 }
 
 static int min(int a, int b) {
@@ -473,40 +751,333 @@ static int max(int a, int b) {
 	else return b;
 }
 
+/**
+ * Transposition table
+ * The same position is reached by placing the same stones in different orders, so minimax results are stored by the board's hash
+ * Each entry records the score, how deep it was searched, whether the score is exact or a bound, and the best move found
+ * The table is a fixed size (set by ttResize), and entries are replaced if the new search went at least as deep or the slot held another position
+ *
+ * The table is shared by the search threads without locks. An entry is packed into one 64 bit word, which is stored next to key ^ data
+ * If two threads write a slot at once, a reader can see one thread's key check with the other's data, which then fails to match the key and is ignored */
+#define TT_EXACT 0
+// score is a lower bound (the search failed high)
+#define TT_LOWER 1
+// score is an upper bound (the search failed low)
+#define TT_UPPER 2
+
+// unpacked entry, as returned by ttProbe
+typedef struct {
+	int16_t score;
+	int8_t depth;
+	uint8_t bound;
+	int8_t x, y;
+} tt_entry_t;
+
+// slot in the table. data holds the packed score (bits 0-15), depth (16-23), bound (24-31), x (32-39), and y (40-47)
+typedef struct {
+	_Atomic uint64_t check;
+	_Atomic uint64_t data;
+} tt_slot_t;
+
+static tt_slot_t *tt = NULL;
+static uint64_t ttMask = 0;
+
+/**
+ * Allocate the transposition table to use at most megabytes of memory (rounded down to a power of two entries)
+ * A size of 0 disables the table
+ * Returns nonzero on failure */
+int ttResize(size_t megabytes) {
+	free(tt);
+	tt = NULL;
+	ttMask = 0;
+	if(megabytes == 0) return 0;
+	size_t entries = 1;
+	while(entries * 2 * sizeof(tt_slot_t) <= megabytes * 1024 * 1024) entries *= 2;
+	tt = calloc(entries, sizeof(tt_slot_t));
+	if(tt == NULL) return 1;
+	ttMask = entries - 1;
+	return 0;
+}
+
+/**
+ * Remove all entries from the transposition table */
+void ttClear() {
+	if(tt != NULL) memset(tt, 0, (ttMask + 1) * sizeof(tt_slot_t));
+}
+
+/**
+ * Look up a position. Returns 1 and copies its entry into entry if it is stored, 0 otherwise */
+static int ttProbe(uint64_t key, tt_entry_t *entry) {
+	if(tt == NULL) return 0;
+	tt_slot_t *slot = &tt[key & ttMask];
+	uint64_t data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+	uint64_t check = atomic_load_explicit(&slot->check, memory_order_relaxed);
+	if((check ^ data) != key) return 0;
+	entry->score = (int16_t)(uint16_t)data;
+	entry->depth = (int8_t)(uint8_t)(data >> 16);
+	entry->bound = (uint8_t)(data >> 24);
+	entry->x = (int8_t)(uint8_t)(data >> 32);
+	entry->y = (int8_t)(uint8_t)(data >> 40);
+	return 1;
+}
+
+static void ttStore(uint64_t key, int score, int depth, int bound, bloc_t x, bloc_t y) {
+	if(tt == NULL) return;
+	tt_slot_t *slot = &tt[key & ttMask];
+	uint64_t old = atomic_load_explicit(&slot->data, memory_order_relaxed);
+	uint64_t oldCheck = atomic_load_explicit(&slot->check, memory_order_relaxed);
+	if((oldCheck ^ old) == key && (int8_t)(uint8_t)(old >> 16) > depth) return;
+	uint64_t data = (uint64_t)(uint16_t)score
+		| (uint64_t)(uint8_t)depth << 16
+		| (uint64_t)(uint8_t)bound << 24
+		| (uint64_t)(uint8_t)x << 32
+		| (uint64_t)(uint8_t)y << 40;
+	atomic_store_explicit(&slot->check, key ^ data, memory_order_relaxed);
+	atomic_store_explicit(&slot->data, data, memory_order_relaxed);
+}
+
+// most plies a search can go (one per cell)
+#define SEARCH_MAX_PLY 226
+
+struct split_s;
+
+/**
+ * Search statistics, to see how well pruning works. Counted per thread, and printed after each move if searchVerbose is set
+ * Build with -DSEARCH_STATS=0 (make RELEASE=1) to compile them out */
+#ifndef SEARCH_STATS
+#define SEARCH_STATS 1
+#endif
+
+typedef struct {
+	// leaves scored by evaluateBoard
+	uint64_t evals;
+	// nodes cut off by alpha-beta, and how many of them by the first move searched
+	uint64_t cutoffs;
+	uint64_t firstMoveCutoffs;
+	// transposition table lookups, how many found the position, and how many of those ended the node
+	uint64_t ttProbes;
+	uint64_t ttHits;
+	uint64_t ttCutoffs;
+} search_stats_t;
+
+#if SEARCH_STATS
+#define SEARCH_STAT(s, field) ((s)->stats.field++)
+#else
+#define SEARCH_STAT(s, field) ((void)0)
+#endif
+
+/**
+ * State for one thread of one minimax search (one iterative deepening run) */
+typedef struct {
+	// index of the thread in the search pool
+	int thread;
+	// innermost split point the thread is searching under (see ybwcSplit), or NULL
+	struct split_s *split;
+	// number of nodes visited
+	uint64_t nodes;
+	// time (from timeMs) at which the search should stop, or 0 for no limit
+	int64_t deadline;
+	// number of empty cells on the root board. A node's ply is rootEmpty - b->empty
+	bloc_t rootEmpty;
+	// killer moves: the last two moves at each ply that caused a cutoff (x, y, or -1 if unset)
+	int8_t killers[SEARCH_MAX_PLY][2][2];
+	// history heuristic: for each player and cell, how much moves there have caused cutoffs (weighted by depth squared)
+	int32_t history[2][16][16];
+#if SEARCH_STATS
+	search_stats_t stats;
+#endif
+} search_t;
+
+// move to try in a node, with its score for ordering
+typedef struct {
+	int8_t x, y;
+	int32_t score;
+} move_t;
+
+// ordering scores for the transposition table move and killer moves, above any history score
+#define ORDER_HASH (1 << 30)
+#define ORDER_KILLER1 (1 << 29)
+#define ORDER_KILLER2 (1 << 28)
+// history scores are halved once any reaches this, so recent cutoffs count for more
+#define HISTORY_MAX (1 << 24)
+
+// how many nodes are visited between checks of the clock
+#define SEARCH_CLOCK_INTERVAL 1024
+
+// set once the deadline passes (by any thread). minimax returns immediately, and the unfinished iteration is thrown out
+static atomic_int searchStop;
+#define SEARCH_STOPPED() atomic_load_explicit(&searchStop, memory_order_relaxed)
+
+// print the result of each minimax iteration
+int searchVerbose = 1;
+// nodes visited by the last minimaxMove (all threads)
+uint64_t searchNodes = 0;
+
+/**
+ * Split point, for the Young Brothers Wait search mode (see ybwcSplit)
+ * A node whose eldest child has been searched, and whose remaining children any thread can pick up */
+typedef struct split_s {
+	// split point the owner was searching under when it made this one, or NULL
+	struct split_s *parent;
+	// the node's board. Threads that join copy it
+	board_t board;
+	move_t moves[225];
+	int moveCount;
+	// index of the next move to hand out
+	atomic_int next;
+	int depth;
+	int isMaximizePlayer;
+	// set when a child fails high, to cancel the searches of the other children (and everything under them)
+	atomic_int cutoff;
+	// number of threads besides the owner searching children
+	atomic_int workers;
+	// alpha, beta, and the best child so far. Guarded by lock
+	atomic_flag lock;
+	int alpha, beta;
+	int value;
+	bloc_t bestX, bestY;
+} split_t;
+
+/**
+ * Check if a thread's search should unwind: the time ran out, or a split point it is searching under got a cutoff */
+static inline int searchAborted(search_t *s) {
+	if(SEARCH_STOPPED()) return 1;
+	for(split_t *sp = s->split; sp != NULL; sp = sp->parent) {
+		if(atomic_load_explicit(&sp->cutoff, memory_order_relaxed)) return 1;
+	}
+	return 0;
+}
+
+static int ybwcSplit(search_t *s, board_t *b, move_t *moves, int moveCount, int depth, int *alpha, int *beta, int isMaximizePlayer, int *value, bloc_t *bestX, bloc_t *bestY);
+
+/**
+ * Current time in milliseconds, from a monotonic clock */
+int64_t timeMs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Fill moves with the candidate moves for player at a node, sorted best first
+ * The transposition table move (hashX, hashY) goes first, then the killer moves for the ply, then the rest by history score
+ * Returns the number of moves */
+static int orderMoves(search_t *s, board_t *b, move_t *moves, player_t player, bloc_t hashX, bloc_t hashY) {
+	int8_t (*killers)[2] = s->killers[s->rootEmpty - b->empty];
+	int32_t (*history)[16] = s->history[PLAYER_INDEX(player)];
+	int count = 0;
+	uint16_t candidates[16];
+	getCandidates(b, candidates);
+	bloc_t x = -1, y;
+	while(nextCandidate(candidates, &x, &y)) {
+		int32_t score;
+		if(x == hashX && y == hashY) score = ORDER_HASH;
+		else if(x == killers[0][0] && y == killers[0][1]) score = ORDER_KILLER1;
+		else if(x == killers[1][0] && y == killers[1][1]) score = ORDER_KILLER2;
+		else score = history[x][y];
+		// insertion sort. Equal scores keep candidate order
+		int i = count++;
+		for(; i > 0 && moves[i - 1].score < score; i--) moves[i] = moves[i - 1];
+		moves[i].x = x;
+		moves[i].y = y;
+		moves[i].score = score;
+	}
+	return count;
+}
+
+/**
+ * Record that player's move at x, y caused a cutoff in a node searched to depth
+ * The move becomes the first killer at its ply, and its history score goes up */
+static void recordCutoff(search_t *s, board_t *b, player_t player, bloc_t x, bloc_t y, int depth) {
+	int8_t (*killers)[2] = s->killers[s->rootEmpty - b->empty];
+	if(killers[0][0] != x || killers[0][1] != y) {
+		killers[1][0] = killers[0][0];
+		killers[1][1] = killers[0][1];
+		killers[0][0] = x;
+		killers[0][1] = y;
+	}
+	int32_t (*history)[16] = s->history[PLAYER_INDEX(player)];
+	history[x][y] += depth * depth;
+	if(history[x][y] >= HISTORY_MAX) {
+		for(int p = 0; p < 2; p++) {
+			for(int hx = 0; hx < 16; hx++) {
+				for(int hy = 0; hy < 16; hy++) s->history[p][hx][hy] /= 2;
+			}
+		}
+	}
+}
+
 /**
  * Minimax search. Search at most depth levels down. Runs alpha-beta pruning
  * In cases where all paths lead to loss, prefer losses further in the future 
+ * Results are stored in the transposition table, which is used to cut off nodes that were already searched
+ * Children are searched best first (see orderMoves), so alpha-beta can prune as much as possible
  * 
- * b is the board to solve 
+ * b is the board to solve. Moves are made and unmade on it in place, so it is unchanged when minimax returns
  * x and y are clobbered. They are the move that is made by the player
  * depth is the max levels down to visit
  * alpha and beta are used for pruning -- they should start at -infinity and +infinity
  * isMaximizePlayer is true if current move should be maximized. Maximizing player is us, minimizing them. Should be true if solving for us
+ * isRoot is true for the first call of a search, which is never cut off by a tie or the transposition table, so x and y are always set
+ * s is the state of the search thread. If the search is aborted (see searchAborted), it unwinds (restoring b) and the returned score is meaningless
  * 
  * returns score of branch */
-static int minimax(board_t *b, bloc_t *x, bloc_t *y, int depth, int alpha, int beta, int isMaximizePlayer) {
-	board_t child;
+static int minimax(search_t *s, board_t *b, bloc_t *x, bloc_t *y, int depth, int alpha, int beta, int isMaximizePlayer, int isRoot) {
 	// scratch x and y
 	bloc_t sx, sy;
+	// check if we are out of time
+	if(++s->nodes % SEARCH_CLOCK_INTERVAL == 0 && s->deadline && timeMs() >= s->deadline) atomic_store(&searchStop, 1);
+	if(searchAborted(s)) return 0;
 	// If node is terminal (win, loss, or tie) return its score
+	// a tie at the root is a board no one can win any more, which is still searched so x and y are set
 	player_t winner = checkWin(b);
 	if(winner == PLAYER_US) return EVAL_INF;
 	else if(winner == PLAYER_THEM) return EVAL_N_INF;
-	else if(winner == PLAYER_TIE) return 0;
+	else if(winner == PLAYER_TIE && !isRoot) return 0;
 
 	// if depth == 0, score the node by the evaluation function
-	if(depth == 0) return evaluateBoard(b);
+	if(depth == 0) {
+		SEARCH_STAT(s, evals);
+		return evaluateBoard(b);
+	}
+
+	// look up the node in the transposition table. The root is always searched so it sets x and y
+	uint64_t key = b->hash ^ (isMaximizePlayer ? 0 : zobristSide);
+	tt_entry_t entry;
+	bloc_t hashX = -1, hashY = -1;
+	SEARCH_STAT(s, ttProbes);
+	if(ttProbe(key, &entry)) {
+		SEARCH_STAT(s, ttHits);
+		hashX = entry.x;
+		hashY = entry.y;
+		if(!isRoot && entry.depth >= depth) {
+			if(entry.bound == TT_EXACT
+			|| (entry.bound == TT_LOWER && entry.score >= beta)
+			|| (entry.bound == TT_UPPER && entry.score <= alpha)) {
+				SEARCH_STAT(s, ttCutoffs);
+				*x = hashX;
+				*y = hashY;
+				return entry.score;
+			}
+		}
+	}
+	int origAlpha = alpha, origBeta = beta;
+	move_t moves[225];
+	int moveCount = orderMoves(s, b, moves, isMaximizePlayer ? PLAYER_US : PLAYER_THEM, hashX, hashY);
 
 	// visit each child branch, and choose the max or min (depending on which player makes this move)
 	if(isMaximizePlayer) {
 		int value = EVAL_N_INF;
 		bloc_t max_x = -1, max_y = -1;
-		// go through each child node
-		*x = -1;
-		while(nextPosition(b, x, y)) {
-			copyWithMove(&child, b, PLAYER_US, *x, *y);
+		// go through each child node, best first
+		for(int i = 0; i < moveCount; i++) {
+			*x = moves[i].x;
+			*y = moves[i].y;
+			makeMove(b, *x, *y, PLAYER_US);
 			// evaluate child node
-			int nodeValue = minimax(&child, &sx, &sy, depth - 1, alpha, beta, 0);
+			int nodeValue = minimax(s, b, &sx, &sy, depth - 1, alpha, beta, 0, 0);
+			unmakeMove(b, *x, *y);
+			if(searchAborted(s)) return 0;
 			// store child move and value if it is max
 			if(nodeValue > value) {
 				value = nodeValue;
@@ -514,43 +1085,654 @@ static int minimax(board_t *b, bloc_t *x, bloc_t *y, int depth, int alpha, int b
 				max_y = *y;
 			}
 			alpha = max(alpha, value);
-			if(alpha >= beta) break;
+			if(alpha >= beta) {
+				SEARCH_STAT(s, cutoffs);
+				if(i == 0) SEARCH_STAT(s, firstMoveCutoffs);
+				recordCutoff(s, b, PLAYER_US, *x, *y, depth);
+				break;
+			}
+			// the eldest child is searched, so idle threads can help with the rest
+			if(i == 0 && ybwcSplit(s, b, moves, moveCount, depth, &alpha, &beta, 1, &value, &max_x, &max_y)) {
+				if(searchAborted(s)) return 0;
+				break;
+			}
 		}
 		*x = max_x;
 		*y = max_y;
+		int bound = value <= origAlpha ? TT_UPPER : (value >= origBeta ? TT_LOWER : TT_EXACT);
 		// make losses better with age
 		if(value < EVAL_MIN) value++;
+		ttStore(key, value, depth, bound, max_x, max_y);
 		return value;
 	} else {
 		int value = EVAL_INF;
 		bloc_t min_x = -1, min_y = -1;
-		// go through each child node
-		*x = -1;
-		while(nextPosition(b, x, y)) {
-			copyWithMove(&child, b, PLAYER_THEM, *x, *y);
+		// go through each child node, best first
+		for(int i = 0; i < moveCount; i++) {
+			*x = moves[i].x;
+			*y = moves[i].y;
+			makeMove(b, *x, *y, PLAYER_THEM);
 			// evaluate child node
-			int nodeValue = minimax(&child, &sx, &sy, depth - 1, alpha, beta, 1);
+			int nodeValue = minimax(s, b, &sx, &sy, depth - 1, alpha, beta, 1, 0);
+			unmakeMove(b, *x, *y);
+			if(searchAborted(s)) return 0;
 			// store child move and value if it is min
 			if(nodeValue < value) {
 				value = nodeValue;
 				min_x = *x;
 				min_y = *y;
 			}
-			alpha = min(alpha, value);
-			if(alpha >= beta) break;
+			beta = min(beta, value);
+			if(alpha >= beta) {
+				SEARCH_STAT(s, cutoffs);
+				if(i == 0) SEARCH_STAT(s, firstMoveCutoffs);
+				recordCutoff(s, b, PLAYER_THEM, *x, *y, depth);
+				break;
+			}
+			// the eldest child is searched, so idle threads can help with the rest
+			if(i == 0 && ybwcSplit(s, b, moves, moveCount, depth, &alpha, &beta, 0, &value, &min_x, &min_y)) {
+				if(searchAborted(s)) return 0;
+				break;
+			}
 		}
 		*x = min_x;
 		*y = min_y;
+		int bound = value <= origAlpha ? TT_UPPER : (value >= origBeta ? TT_LOWER : TT_EXACT);
 		// make losses better with age
 		if(value < EVAL_MIN) value++;
+		ttStore(key, value, depth, bound, min_x, min_y);
 		return value;
 	}
 }
 
 /**
- * Run the minimax algorithm
+ * Search thread pool
+ * Threads are started once (by setSearchThreads) and sleep until poolRun hands them a task. The calling thread runs the task as thread 0
+ * Each thread has its own search state (killers, history, node count), and they share the transposition table */
+#define SEARCH_MAX_THREADS 64
+
+static search_t threadSearch[SEARCH_MAX_THREADS];
+// number of threads searching, and the number started
+static int threadCount = 1;
+static int poolSize = 1;
+static pthread_t poolThreads[SEARCH_MAX_THREADS];
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t poolWake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t poolIdle = PTHREAD_COND_INITIALIZER;
+// the task being run, a counter bumped for each new task, and the number of pool threads still running it
+static void (*poolTask)(int thread);
+static int poolGeneration = 0;
+static int poolBusy = 0;
+
+static void *poolMain(void *arg) {
+	int thread = (int)(intptr_t)arg;
+	pthread_mutex_lock(&poolLock);
+	// a thread added after some tasks ran only runs the ones started after it
+	int seen = poolGeneration;
+	while(1) {
+		while(poolGeneration == seen) pthread_cond_wait(&poolWake, &poolLock);
+		seen = poolGeneration;
+		void (*task)(int) = poolTask;
+		int active = thread < threadCount;
+		pthread_mutex_unlock(&poolLock);
+		if(active) task(thread);
+		pthread_mutex_lock(&poolLock);
+		if(--poolBusy == 0) pthread_cond_signal(&poolIdle);
+	}
+	return NULL;
+}
+
+/**
+ * Start task on every search thread but thread 0 (the caller). poolWait waits for them to finish */
+static void poolStart(void (*task)(int thread)) {
+	pthread_mutex_lock(&poolLock);
+	poolTask = task;
+	poolBusy = poolSize - 1;
+	poolGeneration++;
+	pthread_cond_broadcast(&poolWake);
+	pthread_mutex_unlock(&poolLock);
+}
+
+static void poolWait() {
+	pthread_mutex_lock(&poolLock);
+	while(poolBusy) pthread_cond_wait(&poolIdle, &poolLock);
+	pthread_mutex_unlock(&poolLock);
+}
+
+/**
+ * Run task on every search thread (the caller is thread 0), and wait for all of them to finish */
+static void poolRun(void (*task)(int thread)) {
+	poolStart(task);
+	task(0);
+	poolWait();
+}
+
+/**
+ * Set the number of threads minimaxMove searches with (at most SEARCH_MAX_THREADS)
+ * Returns nonzero on failure */
+int setSearchThreads(int threads) {
+	if(threads < 1 || threads > SEARCH_MAX_THREADS) return 1;
+	pthread_mutex_lock(&poolLock);
+	while(poolSize < threads) {
+		if(pthread_create(&poolThreads[poolSize], NULL, poolMain, (void *)(intptr_t)poolSize)) {
+			pthread_mutex_unlock(&poolLock);
+			return 1;
+		}
+		poolSize++;
+	}
+	threadCount = threads;
+	pthread_mutex_unlock(&poolLock);
+	return 0;
+}
+
+// how the search threads are used (SEARCH_SPLIT_ROOT, SEARCH_LAZY_SMP, or SEARCH_YBWC)
+static int searchMode = SEARCH_SPLIT_ROOT;
+
+/**
+ * Set how minimaxMove uses the search threads, by name: "root" (split the root moves), "lazy" (Lazy SMP), or "ybwc" (Young Brothers Wait)
+ * Returns nonzero if the name is unknown */
+int setSearchMode(const char *name) {
+	if(!strcmp(name, "root")) searchMode = SEARCH_SPLIT_ROOT;
+	else if(!strcmp(name, "lazy")) searchMode = SEARCH_LAZY_SMP;
+	else if(!strcmp(name, "ybwc")) searchMode = SEARCH_YBWC;
+	else return 1;
+	return 0;
+}
+
+/**
+ * Root splitting
+ * The moves at the root of an iteration are handed out to the search threads one at a time, and each thread searches its moves on its own copy of the board
+ * The first move (the previous iteration's best) is searched alone, and the best value so far is shared, so the rest get a tight alpha bound
+ * 
+ * The result is the same as searching the moves in order on one thread: the best move is the first in root order with the highest score
+ * Only a score above the alpha a move was searched with is exact, so only those can replace the best move
+ * A move ordered before the current best is searched with alpha one lower, so a tie with the best is still exact (and wins, being earlier) */
+static struct {
+	board_t *root;
+	move_t moves[225];
+	int moveCount;
+	int depth;
+	// moves are handed out up to this index
+	int limit;
+	// index of the next move to hand out
+	atomic_int next;
+	// best score so far, and the index of its move. Guarded by lock
+	pthread_mutex_t lock;
+	int bestValue;
+	int bestIndex;
+} rootSplit = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static void rootSplitTask(int thread) {
+	search_t *s = &threadSearch[thread];
+	board_t b;
+	memcpy(&b, rootSplit.root, sizeof(board_t));
+	bloc_t sx, sy;
+	int i;
+	while((i = atomic_fetch_add(&rootSplit.next, 1)) < rootSplit.limit) {
+		pthread_mutex_lock(&rootSplit.lock);
+		int alpha = rootSplit.bestValue - (i < rootSplit.bestIndex ? 1 : 0);
+		pthread_mutex_unlock(&rootSplit.lock);
+
+		bloc_t mx = rootSplit.moves[i].x, my = rootSplit.moves[i].y;
+		makeMove(&b, mx, my, PLAYER_US);
+		int value = minimax(s, &b, &sx, &sy, rootSplit.depth - 1, alpha, EVAL_INF, 0, 0);
+		unmakeMove(&b, mx, my);
+		if(SEARCH_STOPPED()) return;
+
+		pthread_mutex_lock(&rootSplit.lock);
+		if(value > alpha && (value > rootSplit.bestValue || (value == rootSplit.bestValue && i < rootSplit.bestIndex))) {
+			rootSplit.bestValue = value;
+			rootSplit.bestIndex = i;
+		}
+		pthread_mutex_unlock(&rootSplit.lock);
+	}
+}
+
+/**
+ * Search the root of b (us to move) to depth, splitting the root moves across the search threads
+ * The previous iteration's best move (from the transposition table) is searched first, then the rest in candidate order
+ * Returns the score and sets x and y to the best move. The result is meaningless if searchStop was set */
+static int searchRoot(board_t *b, int depth, bloc_t *x, bloc_t *y) {
+	uint64_t key = b->hash;
+	tt_entry_t entry;
+	bloc_t hashX = -1, hashY = -1;
+	if(ttProbe(key, &entry)) {
+		hashX = entry.x;
+		hashY = entry.y;
+	}
+	rootSplit.root = b;
+	rootSplit.depth = depth;
+	rootSplit.moveCount = 0;
+	uint16_t candidates[16];
+	getCandidates(b, candidates);
+	bloc_t mx = -1, my;
+	while(nextCandidate(candidates, &mx, &my)) {
+		int i = rootSplit.moveCount++;
+		if(mx == hashX && my == hashY) {
+			for(; i > 0; i--) rootSplit.moves[i] = rootSplit.moves[i - 1];
+		}
+		rootSplit.moves[i].x = mx;
+		rootSplit.moves[i].y = my;
+	}
+	atomic_store(&rootSplit.next, 0);
+	rootSplit.bestValue = EVAL_N_INF;
+	rootSplit.bestIndex = rootSplit.moveCount;
+
+	rootSplit.limit = 1;
+	rootSplitTask(0);
+	atomic_store(&rootSplit.next, 1);
+	rootSplit.limit = rootSplit.moveCount;
+	if(threadCount == 1) rootSplitTask(0);
+	else poolRun(rootSplitTask);
+
+	if(rootSplit.bestIndex == rootSplit.moveCount) {
+		*x = -1;
+		*y = -1;
+		return EVAL_N_INF;
+	}
+	*x = rootSplit.moves[rootSplit.bestIndex].x;
+	*y = rootSplit.moves[rootSplit.bestIndex].y;
+	int value = rootSplit.bestValue;
+	// make losses better with age
+	if(value < EVAL_MIN) value++;
+	if(!SEARCH_STOPPED()) ttStore(key, value, depth, TT_EXACT, *x, *y);
+	return value;
+}
+
+/**
+ * Lazy SMP
+ * Every thread runs its own iterative deepening on a copy of the root, and they share only the transposition table
+ * Thread 0 runs the normal search (with the time limit) and picks the move. The helper threads fill the table with results thread 0 then cuts off on
+ * Odd helpers start a depth ahead, and a helper skips a depth at least half the helpers are already searching, so the helpers spread out over the next few depths
+ * The helpers search until thread 0 finishes and sets searchStop */
+static struct {
+	// copy of the root for the helpers, since thread 0 makes and unmakes moves on the board it was given while they start
+	board_t root;
+	int maxDepth;
+	// number of helpers searching each depth
+	atomic_int searching[SEARCH_MAX_PLY];
+} lazySMP;
+
+static void lazyHelperTask(int thread) {
+	search_t *s = &threadSearch[thread];
+	board_t b;
+	memcpy(&b, &lazySMP.root, sizeof(board_t));
+	bloc_t sx, sy;
+	for(int depth = 1 + (thread & 1); depth <= lazySMP.maxDepth && !SEARCH_STOPPED(); depth++) {
+		if(atomic_load(&lazySMP.searching[depth]) * 2 >= threadCount - 1) continue;
+		atomic_fetch_add(&lazySMP.searching[depth], 1);
+		minimax(s, &b, &sx, &sy, depth, EVAL_N_INF, EVAL_INF, 1, 1);
+		atomic_fetch_sub(&lazySMP.searching[depth], 1);
+	}
+}
+
+/**
+ * Young Brothers Wait
+ * Thread 0 runs the normal search. At any node at least YBWC_MIN_DEPTH from the leaves, once its eldest child is searched without a cutoff,
+ * the node becomes a split point if a thread is idle, and its remaining children are searched by the owner and any threads that join
+ * Each thread keeps a deque of its split points: the owner pushes and pops at the bottom (the deepest), and idle threads steal from the top (the biggest)
+ * A child that fails high sets the split point's cutoff, which cancels the searches of its siblings and of every split point under them
+ * An owner waiting for the threads helping it steals only from split points under its own, so it finishes them sooner */
+#define YBWC_MIN_DEPTH 3
+
+static struct {
+	atomic_flag lock;
+	int count;
+	// one split point per ply at most
+	split_t *splits[SEARCH_MAX_PLY];
+} ybwcDeques[SEARCH_MAX_THREADS];
+
+// number of threads looking for work
+static atomic_int ybwcIdle;
+
+/**
+ * Check if sp is ancestor or a split point under it */
+static int ybwcUnder(split_t *sp, split_t *ancestor) {
+	for(; sp != NULL; sp = sp->parent) {
+		if(sp == ancestor) return 1;
+	}
+	return 0;
+}
+
+/**
+ * Find a split point with children left to search, and join it (counting the thread in its workers)
+ * If ancestor is set, only split points under it are taken
+ * Returns the split point, or NULL if there is no work */
+static split_t *ybwcSteal(int thread, split_t *ancestor) {
+	for(int i = 1; i < threadCount; i++) {
+		int victim = (thread + i) % threadCount;
+		split_t *found = NULL;
+		while(atomic_flag_test_and_set_explicit(&ybwcDeques[victim].lock, memory_order_acquire));
+		for(int j = 0; j < ybwcDeques[victim].count; j++) {
+			split_t *sp = ybwcDeques[victim].splits[j];
+			if(atomic_load(&sp->next) < sp->moveCount && !atomic_load(&sp->cutoff) && (ancestor == NULL || ybwcUnder(sp, ancestor))) {
+				atomic_fetch_add(&sp->workers, 1);
+				found = sp;
+				break;
+			}
+		}
+		atomic_flag_clear_explicit(&ybwcDeques[victim].lock, memory_order_release);
+		if(found != NULL) return found;
+	}
+	return NULL;
+}
+
+/**
+ * Search children of sp on b (a copy of sp's board) until none are left or the search is aborted */
+static void ybwcWork(search_t *s, board_t *b, split_t *sp) {
+	bloc_t sx, sy;
+	player_t player = sp->isMaximizePlayer ? PLAYER_US : PLAYER_THEM;
+	int i;
+	while((i = atomic_fetch_add(&sp->next, 1)) < sp->moveCount) {
+		while(atomic_flag_test_and_set_explicit(&sp->lock, memory_order_acquire));
+		int alpha = sp->alpha, beta = sp->beta;
+		atomic_flag_clear_explicit(&sp->lock, memory_order_release);
+
+		bloc_t mx = sp->moves[i].x, my = sp->moves[i].y;
+		makeMove(b, mx, my, player);
+		int value = minimax(s, b, &sx, &sy, sp->depth - 1, alpha, beta, !sp->isMaximizePlayer, 0);
+		unmakeMove(b, mx, my);
+		if(searchAborted(s)) return;
+
+		while(atomic_flag_test_and_set_explicit(&sp->lock, memory_order_acquire));
+		if(sp->isMaximizePlayer ? value > sp->value : value < sp->value) {
+			sp->value = value;
+			sp->bestX = mx;
+			sp->bestY = my;
+		}
+		if(sp->isMaximizePlayer) sp->alpha = max(sp->alpha, value);
+		else sp->beta = min(sp->beta, value);
+		int cutoff = sp->alpha >= sp->beta;
+		atomic_flag_clear_explicit(&sp->lock, memory_order_release);
+		if(cutoff) {
+			SEARCH_STAT(s, cutoffs);
+			atomic_store(&sp->cutoff, 1);
+			recordCutoff(s, b, player, mx, my, sp->depth);
+			return;
+		}
+	}
+}
+
+/**
+ * Search children of a split point found by ybwcSteal, on a copy of its board */
+static void ybwcJoin(search_t *s, split_t *sp) {
+	board_t b;
+	memcpy(&b, &sp->board, sizeof(board_t));
+	split_t *saved = s->split;
+	s->split = sp;
+	ybwcWork(s, &b, sp);
+	s->split = saved;
+	atomic_fetch_sub(&sp->workers, 1);
+}
+
+/**
+ * Called by minimax once the eldest child (moves[0]) of a node is searched. If the node is deep enough and a thread is idle,
+ * search the rest of the children in parallel, updating alpha, beta, value, and the best move as minimax's loop would
+ * Returns 0 if the node wasn't split (minimax searches the rest itself), 1 once all children are searched or the search is aborted */
+static int ybwcSplit(search_t *s, board_t *b, move_t *moves, int moveCount, int depth, int *alpha, int *beta, int isMaximizePlayer, int *value, bloc_t *bestX, bloc_t *bestY) {
+	if(searchMode != SEARCH_YBWC || threadCount == 1 || depth < YBWC_MIN_DEPTH || moveCount < 3 || atomic_load(&ybwcIdle) == 0) return 0;
+	split_t sp;
+	sp.parent = s->split;
+	memcpy(&sp.board, b, sizeof(board_t));
+	memcpy(sp.moves, moves, moveCount * sizeof(move_t));
+	sp.moveCount = moveCount;
+	atomic_init(&sp.next, 1);
+	sp.depth = depth;
+	sp.isMaximizePlayer = isMaximizePlayer;
+	atomic_init(&sp.cutoff, 0);
+	atomic_init(&sp.workers, 0);
+	atomic_flag_clear(&sp.lock);
+	sp.alpha = *alpha;
+	sp.beta = *beta;
+	sp.value = *value;
+	sp.bestX = *bestX;
+	sp.bestY = *bestY;
+
+	int thread = s->thread;
+	while(atomic_flag_test_and_set_explicit(&ybwcDeques[thread].lock, memory_order_acquire));
+	ybwcDeques[thread].splits[ybwcDeques[thread].count++] = &sp;
+	atomic_flag_clear_explicit(&ybwcDeques[thread].lock, memory_order_release);
+
+	s->split = &sp;
+	ybwcWork(s, b, &sp);
+	s->split = sp.parent;
+
+	// once it is off the deque no more threads can join, so wait for the ones that did (helping with their split points meanwhile)
+	while(atomic_flag_test_and_set_explicit(&ybwcDeques[thread].lock, memory_order_acquire));
+	ybwcDeques[thread].count--;
+	atomic_flag_clear_explicit(&ybwcDeques[thread].lock, memory_order_release);
+	while(atomic_load(&sp.workers) > 0) {
+		atomic_fetch_add(&ybwcIdle, 1);
+		split_t *job = ybwcSteal(thread, &sp);
+		atomic_fetch_sub(&ybwcIdle, 1);
+		if(job != NULL) ybwcJoin(s, job);
+		else sched_yield();
+	}
+
+	*alpha = sp.alpha;
+	*beta = sp.beta;
+	*value = sp.value;
+	*bestX = sp.bestX;
+	*bestY = sp.bestY;
+	return 1;
+}
+
+/**
+ * Helper threads wait for split points to join until thread 0 finishes and sets searchStop */
+static void ybwcHelperTask(int thread) {
+	search_t *s = &threadSearch[thread];
+	while(!SEARCH_STOPPED()) {
+		atomic_fetch_add(&ybwcIdle, 1);
+		split_t *job = ybwcSteal(thread, NULL);
+		atomic_fetch_sub(&ybwcIdle, 1);
+		if(job != NULL) ybwcJoin(s, job);
+		else sched_yield();
+	}
+}
+
+/**
+ * Reset the search state of every thread for a search from b */
+static void searchInit(board_t *b) {
+	for(int i = 0; i < threadCount; i++) {
+		search_t *s = &threadSearch[i];
+		memset(s, 0, sizeof(search_t));
+		memset(s->killers, -1, sizeof(s->killers));
+		s->rootEmpty = b->empty;
+		s->thread = i;
+	}
+}
+
+/**
+ * Iterative deepening for minimaxMove and the ponder thread. searchInit must be called, and searchStop cleared, first
+ * Setting searchStop stops the search, keeping the last completed iteration
+ * verbose prints the result of each iteration
+ * Returns the depth of the last completed iteration, or 0 if there was none */
+static int iterativeDeepening(board_t *b, bloc_t *x, bloc_t *y, int maxDepth, int timeLimit, int verbose) {
+	int64_t start = timeMs();
+	bloc_t bestX = -1, bestY = -1;
+	int completed = 0;
+#if SEARCH_STATS
+	// nodes visited by the iterations so far, and by the last one
+	uint64_t lastNodes = 0, lastIterationNodes = 0;
+#endif
+	if(maxDepth > b->empty) maxDepth = b->empty;
+	// nothing to search if the game is already over. A board no one can win any more still gets a move
+	player_t winner = checkWin(b);
+	if(winner == PLAYER_US || winner == PLAYER_THEM || !b->empty) maxDepth = 0;
+	int lazy = searchMode == SEARCH_LAZY_SMP;
+	// Lazy SMP and Young Brothers Wait helpers run for the whole search. Thread 0 searches from the root
+	int helpers = searchMode != SEARCH_SPLIT_ROOT && threadCount > 1 && maxDepth > 0;
+	if(helpers && lazy) {
+		memcpy(&lazySMP.root, b, sizeof(board_t));
+		lazySMP.maxDepth = maxDepth;
+		for(int depth = 0; depth <= maxDepth; depth++) atomic_store(&lazySMP.searching[depth], 0);
+		poolStart(lazyHelperTask);
+	} else if(helpers) poolStart(ybwcHelperTask);
+
+	for(int depth = 1; depth <= maxDepth; depth++) {
+		bloc_t moveX, moveY;
+		int score;
+		if(searchMode != SEARCH_SPLIT_ROOT) score = minimax(&threadSearch[0], b, &moveX, &moveY, depth, EVAL_N_INF, EVAL_INF, 1, 1);
+		else score = searchRoot(b, depth, &moveX, &moveY);
+		if(SEARCH_STOPPED()) {
+			if(verbose) printf("Minimax depth %i ran out of time\n", depth);
+			break;
+		}
+		bestX = moveX;
+		bestY = moveY;
+		completed = depth;
+		int64_t elapsed = timeMs() - start;
+		uint64_t nodes = 0;
+		// Lazy SMP helpers are still running, so only thread 0 is counted
+		for(int i = 0; i < (lazy ? 1 : threadCount); i++) nodes += threadSearch[i].nodes;
+		if(verbose) printf("Minimax depth %i: Score: %i, Move: (%li, %li), Nodes: %lu, Time: %lims\n", depth, score, bestX, bestY, (unsigned long)nodes, (long)elapsed);
+#if SEARCH_STATS
+		// effective branching factor: how many times more nodes this iteration took than the one before
+		if(verbose && lastIterationNodes) printf("Minimax depth %i: Effective branching factor: %.2f\n", depth, (double)(nodes - lastNodes) / lastIterationNodes);
+		lastIterationNodes = nodes - lastNodes;
+		lastNodes = nodes;
+#endif
+		// a win or loss was found, which deeper searches won't change
+		if(score > EVAL_MAX || score < EVAL_MIN) break;
+		if(timeLimit) {
+			// the next iteration takes longer than all the previous ones together, so don't start one that can't finish
+			if(elapsed * 2 >= timeLimit) break;
+			// Lazy SMP helpers are still running, and only stop when thread 0 does
+			for(int i = 0; i < (lazy ? 1 : threadCount); i++) threadSearch[i].deadline = start + timeLimit;
+		}
+	}
+	if(helpers) {
+		atomic_store(&searchStop, 1);
+		poolWait();
+	}
+
+	*x = bestX;
+	*y = bestY;
+	return completed;
+}
+
+#if SEARCH_STATS
+/**
+ * Print the statistics of the last search, summed over the threads */
+static void printSearchStats() {
+	search_stats_t total;
+	memset(&total, 0, sizeof(search_stats_t));
+	for(int i = 0; i < threadCount; i++) {
+		search_stats_t *stats = &threadSearch[i].stats;
+		total.evals += stats->evals;
+		total.cutoffs += stats->cutoffs;
+		total.firstMoveCutoffs += stats->firstMoveCutoffs;
+		total.ttProbes += stats->ttProbes;
+		total.ttHits += stats->ttHits;
+		total.ttCutoffs += stats->ttCutoffs;
+	}
+	printf("Search stats: Nodes: %llu, Evals: %llu, Cutoffs: %llu (%.1f%% on first move), TT probes: %llu, hits: %llu (%.1f%%), cutoffs: %llu\n",
+		(unsigned long long)searchNodes, (unsigned long long)total.evals,
+		(unsigned long long)total.cutoffs, total.cutoffs ? 100.0 * total.firstMoveCutoffs / total.cutoffs : 0,
+		(unsigned long long)total.ttProbes, (unsigned long long)total.ttHits, total.ttProbes ? 100.0 * total.ttHits / total.ttProbes : 0,
+		(unsigned long long)total.ttCutoffs);
+}
+#endif
+
+/**
+ * Run the minimax algorithm with iterative deepening
+ * Searches at depth 1, 2, 3, ... until maxDepth is reached, the result is decided (a forced win or loss), or timeLimit (in ms, 0 for none) runs out
+ * Each iteration fills the transposition table, so the next one searches the best move first
+ * With more than one search thread (see setSearchThreads), the root moves are split across them, they run Lazy SMP, or they split nodes by Young Brothers Wait (see setSearchMode)
+ * x and y are set to the best move of the last completed iteration. The first iteration is always completed
  */
-int minimaxMove(board_t *b, bloc_t *x, bloc_t *y, int depth) {
-	printf("Minimax Score: %i\n", minimax(b, x, y, depth, EVAL_N_INF, EVAL_INF, 1));
+int minimaxMove(board_t *b, bloc_t *x, bloc_t *y, int maxDepth, int timeLimit) {
+	searchInit(b);
+	atomic_store(&searchStop, 0);
+	iterativeDeepening(b, x, y, maxDepth, timeLimit, searchVerbose);
+	searchNodes = 0;
+	for(int i = 0; i < threadCount; i++) searchNodes += threadSearch[i].nodes;
+#if SEARCH_STATS
+	if(searchVerbose) printSearchStats();
+#endif
 	return *x != -1 && *y != -1;
-}
\ No newline at end of file
+}
+
+/**
+ * Pondering
+ * After we move, a background thread guesses the opponent's reply and searches the position it leads to until ponderStop is called
+ * The transposition table is kept between moves, so if the guess was right, minimaxMove on the real board finds most of the tree
+ * already searched and goes deeper in the same time. If it was wrong, the search is just stopped */
+// how deep to search for the opponent's reply when the transposition table doesn't have it
+#define PONDER_PREDICT_DEPTH 2
+
+static struct {
+	pthread_t thread;
+	int running;
+	// the position being searched (after our move and the predicted reply)
+	board_t board;
+	// the predicted reply, and the depth the search reached
+	bloc_t x, y;
+	int depth;
+	// set when a search is stopped, until ponderHit checks it
+	int stopped;
+} ponder;
+
+static void *ponderMain(void *arg) {
+	(void)arg;
+	bloc_t x, y;
+	ponder.depth = iterativeDeepening(&ponder.board, &x, &y, ponder.board.empty, 0, 0);
+	return NULL;
+}
+
+/**
+ * Start pondering after we play (x, y) on b. b isn't changed
+ * The opponent's reply is predicted from the transposition table (the last search's best line), or by a shallow search if it isn't there
+ * Nothing is started if the game is over after our move or the reply */
+void ponderStart(board_t *b, bloc_t x, bloc_t y) {
+	ponderStop();
+	ponder.stopped = 0;
+	board_t *pb = &ponder.board;
+	memcpy(pb, b, sizeof(board_t));
+	makeMove(pb, x, y, PLAYER_US);
+	if(checkWin(pb) != PLAYER_NONE) return;
+
+	tt_entry_t entry;
+	bloc_t replyX = -1, replyY = -1;
+	if(ttProbe(pb->hash ^ zobristSide, &entry) && entry.x != -1) {
+		replyX = entry.x;
+		replyY = entry.y;
+	} else {
+		searchInit(pb);
+		atomic_store(&searchStop, 0);
+		minimax(&threadSearch[0], pb, &replyX, &replyY, PONDER_PREDICT_DEPTH, EVAL_N_INF, EVAL_INF, 0, 1);
+	}
+	if(replyX == -1 || replyY == -1) return;
+	makeMove(pb, replyX, replyY, PLAYER_THEM);
+	if(checkWin(pb) != PLAYER_NONE) return;
+
+	ponder.x = replyX;
+	ponder.y = replyY;
+	ponder.depth = 0;
+	searchInit(pb);
+	atomic_store(&searchStop, 0);
+	if(pthread_create(&ponder.thread, NULL, ponderMain, NULL)) return;
+	ponder.running = 1;
+}
+
+/**
+ * Stop pondering, if it was started
+ * The ponder thread searches with M, N, and K and the tables syncBoard builds for them, so it must be stopped before they change */
+void ponderStop() {
+	if(!ponder.running) return;
+	atomic_store(&searchStop, 1);
+	pthread_join(ponder.thread, NULL);
+	ponder.running = 0;
+	ponder.stopped = 1;
+}
+
+/**
+ * Check the board we now have to move on (synced) against the position that was pondered, after ponderStop
+ * Returns 1 if it is the same, 0 otherwise (or if nothing was pondered since the last check) */
+int ponderHit(board_t *b) {
+	if(!ponder.stopped) return 0;
+	ponder.stopped = 0;
+	int hit = b->hash == ponder.board.hash && !memcmp(b->bits, ponder.board.bits, sizeof(b->bits));
+	if(searchVerbose) printf("Pondered reply (%li, %li) to depth %i: %s\n", ponder.x, ponder.y, ponder.depth, hit ? "hit" : "miss");
+	return hit;
+}
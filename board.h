@@ -1,18 +1,56 @@
+#ifndef BOARD_H
+#define BOARD_H
+
 #include <immintrin.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 
+// one dimensional position in a board
+typedef int_fast32_t bloc_t;
+
+// build with -DROTATED_BOARDS=1 (make ROTATED=1) to keep copies of the board along rows and diagonals as well as columns
+#ifndef ROTATED_BOARDS
+#define ROTATED_BOARDS 0
+#endif
+
+// most K long windows a board can have (K = 1 on 15x15, a window per cell and direction)
+#define WINDOW_MAX (4 * 15 * 15)
+
 // represents the state of a board
 typedef struct {
 	// the board is always 15x15. If m and n are smaller, extra cells are kept blank
 
-	// each cell is 0 for a blank board, 1 for us, 2 for them
-	uint8_t board[15][16];
+	// one bitboard per player (index 0 is us, 1 is them)
+	// each column x is a 16 bit mask, with bit y set if the player has a stone at (x, y)
+	// column 15 and bit 15 are always blank, so runs can be shifted in without overflowing the 15x16 layout
+	uint16_t bits[2][16];
+#if ROTATED_BOARDS
+	// the same stones along the other directions, so every line of the board is a mask: a bit per player for the stone in column x of
+	// row y, diagonal x + y (down and left), and anti diagonal x - y + N - 1 (down and right). Kept up to date as moves are made
+	uint16_t rows[2][16];
+	uint16_t diags[2][32];
+	uint16_t antiDiags[2][32];
+#endif
+
+	// number of empty cells in the M x N board, kept up to date as moves are made
+	bloc_t empty;
+	// evaluation score of the board (see evaluateBoard in board.c), kept up to date as moves are made
+	int score;
+	// stones in each K long window of the window table in board.c (ours in the low 4 bits, theirs in the high 4), kept up to date as moves are made
+	// and the number of windows still live (without stones from both players), one stone from a win for each player, and won by each player
+	uint8_t windows[WINDOW_MAX];
+	int live;
+	int threats[2];
+	int wins[2];
+	// zobrist hash of the stones on the board (and M, N, and K), kept up to date as moves are made
+	uint64_t hash;
+	// number of stones within candidateRadius of each cell, and a mask per column of the cells where it is nonzero
+	// empty cells in nearBits are the candidate moves searched by minimax and basicSolve
+	uint8_t near[16][16];
+	uint16_t nearBits[16];
 } board_t;
 
-// one dimensional position in a board
-typedef int_fast32_t bloc_t;
 // player type
 typedef uint_fast8_t player_t;
 
@@ -21,16 +59,52 @@ typedef uint_fast8_t player_t;
 #define PLAYER_THEM ((player_t)2)
 #define PLAYER_TIE ((player_t)4)
 
+// index into board_t.bits for a player (PLAYER_US or PLAYER_THEM)
+#define PLAYER_INDEX(p) ((p) - 1)
+
+/**
+ * Get the contents of a cell (PLAYER_NONE, PLAYER_US, or PLAYER_THEM) */
+static inline player_t getCell(const board_t *b, bloc_t x, bloc_t y) {
+	return ((b->bits[0][x] >> y) & 1) | (((b->bits[1][x] >> y) & 1) << 1);
+}
+
+/**
+ * Set the contents of a cell to PLAYER_NONE, PLAYER_US, or PLAYER_THEM */
+static inline void setCell(board_t *b, bloc_t x, bloc_t y, player_t player) {
+	b->bits[0][x] &= ~(1u << y);
+	b->bits[1][x] &= ~(1u << y);
+	if(player == PLAYER_US || player == PLAYER_THEM) b->bits[PLAYER_INDEX(player)][x] |= 1u << y;
+}
+
+void syncBoard(board_t *b);
 void printBoard(board_t *b);
+void printBoardWithMove(board_t *b, bloc_t moveX, bloc_t moveY);
 extern bloc_t M,N,K;
+extern bloc_t candidateRadius;
 int basicSolve(board_t *b, bloc_t *x, bloc_t *y);
 int backUpMove(board_t *b, bloc_t *x, bloc_t *y);
 int higestScoredMove(board_t *b, bloc_t *x, bloc_t *y);
-int minimaxMove(board_t *b, bloc_t *x, bloc_t *y, int depth);
+int minimaxMove(board_t *b, bloc_t *x, bloc_t *y, int maxDepth, int timeLimit);
 int countEmpty(board_t *b);
+int64_t timeMs();
+void ponderStart(board_t *b, bloc_t x, bloc_t y);
+void ponderStop();
+int ponderHit(board_t *b);
+int setSearchThreads(int threads);
+int setSearchMode(const char *name);
+// how minimaxMove uses the search threads
+#define SEARCH_SPLIT_ROOT 0
+#define SEARCH_LAZY_SMP 1
+#define SEARCH_YBWC 2
+extern int searchVerbose;
+extern uint64_t searchNodes;
+int ttResize(size_t megabytes);
+void ttClear(void);
 // highest score possible by evaluation function
 #define EVAL_MAX (7230)
 #define EVAL_MIN (-7230)
 
 #define EVAL_INF (10000)
 #define EVAL_N_INF (-10000)
+
+#endif
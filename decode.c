@@ -0,0 +1,325 @@
+#include "decode.h"
+#include <stdlib.h>
+
+/**
+ * Decoding the /api/board response
+ * The fast decoder is a state machine that reads one character at a time, so a response can be split into chunks anywhere
+ * It only accepts the shape the server sends. On anything else it gives up, and the generic parser replays the response from the start */
+
+// states of the fast decoder
+// before the opening {
+#define DECODE_START 0
+// expecting a key (or the closing })
+#define DECODE_KEY 1
+// reading a key
+#define DECODE_KEY_STRING 2
+// expecting the : after a key
+#define DECODE_COLON 3
+// expecting a value
+#define DECODE_VALUE 4
+// reading a number (m, n, k, or a cell)
+#define DECODE_NUMBER 5
+// expecting , or } after a value
+#define DECODE_AFTER_VALUE 6
+// in the board array, expecting a column (or the closing ])
+#define DECODE_COLUMN 7
+// in a column, expecting a cell (or the closing ])
+#define DECODE_CELL 8
+// expecting , or ] after a cell
+#define DECODE_AFTER_CELL 9
+// expecting , or ] after a column
+#define DECODE_AFTER_COLUMN 10
+// after the closing }
+#define DECODE_END 11
+
+// the board holds at most 15x15 cells
+#define DECODE_MAX_SIZE 15
+
+static int json_board_callback(void *userdata, int type, const char *data, uint32_t length)
+{
+  board_decoder_t *dec = (board_decoder_t *)userdata;
+
+	switch (type) {
+	case JSON_ARRAY_END:
+		dec->y = 0;
+    dec->x++;
+		break;
+	case JSON_KEY:
+    if(!strncmp(data, "m", length)) dec->lastParam = 0;
+    else if(!strncmp(data, "n", length)) dec->lastParam = 1;
+    else if(!strncmp(data, "k", length)) dec->lastParam = 2;
+    else if(!strncmp(data, "board", length)) dec->lastParam = 3;
+    else dec->lastParam = -1;
+    break;
+	case JSON_INT:
+    if(dec->lastParam >= 0 && dec->lastParam <= 2) {
+      // the board holds at most 15x15 cells, and a window counts at most 15 stones in a row
+      long value = strtol(data, NULL, 10);
+      if(value < 1 || value > DECODE_MAX_SIZE) {
+        fprintf(stderr, "board size out of range\n");
+        return 1;
+      }
+      if(dec->lastParam == 0) dec->m = value;
+      if(dec->lastParam == 1) dec->n = value;
+      if(dec->lastParam == 2) dec->k = value;
+    }
+    if(dec->lastParam == 3) {
+      int cell = strtol(data, NULL, 10);
+      // m and n usually come first. The board holds at most 15x15 either way
+      if(dec->x >= (dec->m ? dec->m : DECODE_MAX_SIZE) || dec->y >= (dec->n ? dec->n : DECODE_MAX_SIZE)) fprintf(stderr, "board data exceeded M and N\n");
+      else if(cell == -1) setCell(dec->board, dec->x, dec->y, PLAYER_NONE);
+      else if(cell == 0) setCell(dec->board, dec->x, dec->y, PLAYER_US);
+      else if(cell == 1) setCell(dec->board, dec->x, dec->y, PLAYER_THEM);
+      dec->y++;
+    }
+    break;
+  case JSON_OBJECT_END:
+    dec->lastParam = -1;
+    dec->x = 0;
+    dec->y = 0;
+    break;
+	case JSON_NULL:
+		dec->isNull = 1;
+  case JSON_ARRAY_BEGIN:
+  case JSON_OBJECT_BEGIN:
+    break;
+	default:
+    fprintf(stderr, "Unexpected JSON atom type\n");
+	}
+
+  return 0;
+}
+
+/**
+ * Set up dec to decode a response into board (which is cleared)
+ * If generic is set, the fast decoder is skipped and everything goes to the generic parser */
+void decoderInit(board_decoder_t *dec, board_t *board, int generic) {
+	dec->board = board;
+	dec->m = dec->n = dec->k = 0;
+	dec->lastParam = -1;
+	dec->x = dec->y = 0;
+	dec->started = 0;
+	dec->isNull = 0;
+	dec->error = 0;
+	dec->generic = 0;
+	dec->state = DECODE_START;
+	dec->replayLength = 0;
+	memset(board, 0, sizeof(board_t));
+	if(generic) {
+		if(json_parser_init(&dec->parser, NULL, &json_board_callback, dec)) {
+			fprintf(stderr, "Failed to initialize JSON parser\n");
+			dec->error = -1;
+		} else dec->generic = 1;
+	}
+}
+
+/**
+ * Hand the response to the generic parser, replaying all of it so far (which includes the current chunk)
+ * Returns nonzero on failure */
+static int decoderFallback(board_decoder_t *dec) {
+	if(dec->replayLength > DECODE_REPLAY_SIZE) {
+		fprintf(stderr, "Unexpected board data too long to replay\n");
+		dec->error = -1;
+		return 1;
+	}
+	board_t *board = dec->board;
+	size_t replayLength = dec->replayLength;
+	decoderInit(dec, board, 1);
+	if(dec->error) return 1;
+	dec->started = 1;
+	return (dec->error = json_parser_string(&dec->parser, dec->replay, replayLength, NULL)) != 0;
+}
+
+/**
+ * Store the number just read by the fast decoder
+ * Returns nonzero if it isn't a value the payload can hold */
+static int decodeNumber(board_decoder_t *dec) {
+	if(!dec->digits) return 1;
+	int value = dec->negative ? -dec->number : dec->number;
+	if(dec->lastParam == 0) dec->m = value;
+	else if(dec->lastParam == 1) dec->n = value;
+	else if(dec->lastParam == 2) dec->k = value;
+	else {
+		if(value < -1 || value > 1) return 1;
+		if(dec->x >= (dec->m ? dec->m : DECODE_MAX_SIZE) || dec->y >= (dec->n ? dec->n : DECODE_MAX_SIZE)) return 1;
+		// the board starts out empty. 0 is us, 1 is them
+		if(value != -1) dec->board->bits[value][dec->x] |= 1u << dec->y;
+		dec->y++;
+		dec->state = DECODE_AFTER_CELL;
+		return 0;
+	}
+	if(value < 1 || value > DECODE_MAX_SIZE) return 1;
+	dec->state = DECODE_AFTER_VALUE;
+	return 0;
+}
+
+/**
+ * Start reading a number (m, n, k, or a cell) at its first character c
+ * Returns nonzero if c can't start one */
+static int decodeNumberStart(board_decoder_t *dec, char c) {
+	dec->number = 0;
+	dec->digits = 0;
+	dec->negative = c == '-';
+	if(c >= '0' && c <= '9') {
+		dec->number = c - '0';
+		dec->digits = 1;
+	} else if(c != '-') return 1;
+	dec->state = DECODE_NUMBER;
+	return 0;
+}
+
+/**
+ * Run the fast decoder over a chunk
+ * Returns nonzero if the chunk doesn't fit the payload's shape */
+static int decodeFast(board_decoder_t *dec, const char *data, size_t length) {
+	bloc_t maxX = dec->m ? dec->m : DECODE_MAX_SIZE, maxY = dec->n ? dec->n : DECODE_MAX_SIZE;
+	for(size_t i = 0; i < length; i++) {
+		char c = data[i];
+		// cells are almost all of the payload, so a whole "0," "1," or "-1," (or with ]) is read at once when it is in this chunk
+		if(dec->state == DECODE_CELL && i + 2 < length && dec->x < maxX && dec->y < maxY) {
+			int width = c == '-' ? (data[i + 1] == '1' ? 2 : 0) : (c == '0' || c == '1');
+			char next = data[i + width];
+			if(width && (next == ',' || next == ']')) {
+				if(width == 1) dec->board->bits[c - '0'][dec->x] |= 1u << dec->y;
+				dec->y++;
+				// leave the ] to close the column
+				if(next == ',') i += width;
+				else {
+					i += width - 1;
+					dec->state = DECODE_AFTER_CELL;
+				}
+				continue;
+			}
+		}
+		if(dec->state == DECODE_NUMBER) {
+			if(c >= '0' && c <= '9') {
+				if(++dec->digits > 4) return 1;
+				dec->number = dec->number * 10 + (c - '0');
+				continue;
+			}
+			if(decodeNumber(dec)) return 1;
+		}
+		if(dec->state == DECODE_KEY_STRING) {
+			if(c == '"') {
+				dec->key[dec->keyLength] = 0;
+				if(!strcmp(dec->key, "m")) dec->lastParam = 0;
+				else if(!strcmp(dec->key, "n")) dec->lastParam = 1;
+				else if(!strcmp(dec->key, "k")) dec->lastParam = 2;
+				else if(!strcmp(dec->key, "board")) {
+					dec->lastParam = 3;
+					maxX = dec->m ? dec->m : DECODE_MAX_SIZE;
+					maxY = dec->n ? dec->n : DECODE_MAX_SIZE;
+				} else return 1;
+				dec->state = DECODE_COLON;
+			} else if(c == '\\' || dec->keyLength == sizeof(dec->key) - 1) return 1;
+			else dec->key[dec->keyLength++] = c;
+			continue;
+		}
+		if(c == ' ' || c == '\n' || c == '\r' || c == '\t') continue;
+		switch(dec->state) {
+			case DECODE_START:
+				if(c != '{') return 1;
+				dec->state = DECODE_KEY;
+				break;
+			case DECODE_KEY:
+				if(c == '}') dec->state = DECODE_END;
+				else if(c == '"') {
+					dec->keyLength = 0;
+					dec->state = DECODE_KEY_STRING;
+				} else return 1;
+				break;
+			case DECODE_COLON:
+				if(c != ':') return 1;
+				dec->state = DECODE_VALUE;
+				break;
+			case DECODE_VALUE:
+				if(dec->lastParam == 3) {
+					if(c != '[') return 1;
+					dec->x = 0;
+					dec->state = DECODE_COLUMN;
+				} else if(decodeNumberStart(dec, c)) return 1;
+				break;
+			case DECODE_CELL:
+				if(c == ']') {
+					dec->x++;
+					dec->state = DECODE_AFTER_COLUMN;
+				} else if(decodeNumberStart(dec, c)) return 1;
+				break;
+			case DECODE_AFTER_VALUE:
+				if(c == ',') dec->state = DECODE_KEY;
+				else if(c == '}') dec->state = DECODE_END;
+				else return 1;
+				break;
+			case DECODE_COLUMN:
+				if(c == '[') {
+					dec->y = 0;
+					dec->state = DECODE_CELL;
+				} else if(c == ']') dec->state = DECODE_AFTER_VALUE;
+				else return 1;
+				break;
+			case DECODE_AFTER_CELL:
+				if(c == ',') dec->state = DECODE_CELL;
+				else if(c == ']') {
+					dec->x++;
+					dec->state = DECODE_AFTER_COLUMN;
+				} else return 1;
+				break;
+			case DECODE_AFTER_COLUMN:
+				if(c == ',') dec->state = DECODE_COLUMN;
+				else if(c == ']') dec->state = DECODE_AFTER_VALUE;
+				else return 1;
+				break;
+			default:
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Decode the next chunk of the response
+ * Returns nonzero if it can't be parsed */
+int decoderFeed(board_decoder_t *dec, const char *data, size_t length) {
+	if(dec->error) return 1;
+	if(dec->isNull) return 0;
+	if(!dec->started) {
+		// a plain "null" body (no game) isn't something the parser accepts
+		while(length && (*data == ' ' || *data == '\n' || *data == '\r' || *data == '\t')) {
+			data++;
+			length--;
+		}
+		if(!length) return 0;
+		dec->started = 1;
+		if(*data == 'n') {
+			dec->isNull = 1;
+			return 0;
+		}
+	}
+	if(dec->generic) return (dec->error = json_parser_string(&dec->parser, data, length, NULL)) != 0;
+
+	if(dec->replayLength + length <= DECODE_REPLAY_SIZE) memcpy(dec->replay + dec->replayLength, data, length);
+	dec->replayLength += length;
+	if(decodeFast(dec, data, length)) return decoderFallback(dec);
+	return 0;
+}
+
+/**
+ * Finish decoding, once the whole response is fed
+ * Returns 0 if a board was decoded (into the board, and m, n, and k), nonzero if it was null or couldn't be parsed */
+int decoderFinish(board_decoder_t *dec) {
+	int failed = dec->error != 0;
+	if(dec->error > 0) fprintf(stderr, "Failed to parse JSON data %i\n", dec->error);
+	else if(!failed && !dec->isNull) {
+		if((dec->generic ? !json_parser_is_done(&dec->parser) : dec->state != DECODE_END)) {
+			fprintf(stderr, "Incomplete JSON data\n");
+			failed = 1;
+		}
+	}
+	if(dec->generic) json_parser_free(&dec->parser);
+	dec->generic = 0;
+	if(failed || dec->isNull) {
+		memset(dec->board, 0, sizeof(board_t));
+		return 1;
+	}
+	return 0;
+}
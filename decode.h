@@ -0,0 +1,50 @@
+#ifndef DECODE_H
+#define DECODE_H
+
+#include <json.h>
+#include "board.h"
+
+// longest response the fast decoder can hand back to the generic parser if it finds something unexpected
+#define DECODE_REPLAY_SIZE 4096
+
+/**
+ * State for decoding one board response, which can arrive in any number of chunks
+ * The payload always looks like {"m":15,"n":15,"k":5,"board":[[-1,0,1,...],...]} (the board is a list of columns), so a
+ * decoder made for that shape reads it in one pass, writing cells straight into board and allocating nothing
+ * Anything else (other keys, strings, floats, ...) hands the response to the generic libjson parser, which replays what was seen so far */
+typedef struct {
+	board_t *board;
+	// m, n, and k from the response (0 if not seen yet)
+	bloc_t m, n, k;
+	// 0 for m, 1 for n, 2 for k, 3 for board
+	int lastParam;
+	// position of the next cell in the board array
+	int x, y;
+	// set once the first character of the response has been seen
+	int started;
+	// set if the server sent a null board
+	int isNull;
+	// nonzero if the parser failed (its error code)
+	int error;
+
+	// set once the response is given to the generic parser
+	int generic;
+	json_parser parser;
+
+	// state of the fast decoder (one of the DECODE_* states in decode.c), the key being read, and the number being read
+	int state;
+	char key[8];
+	int keyLength;
+	int number;
+	int negative;
+	int digits;
+	// the response so far, for the generic parser to replay. replayLength is past DECODE_REPLAY_SIZE if it didn't fit
+	char replay[DECODE_REPLAY_SIZE];
+	size_t replayLength;
+} board_decoder_t;
+
+void decoderInit(board_decoder_t *dec, board_t *board, int generic);
+int decoderFeed(board_decoder_t *dec, const char *data, size_t length);
+int decoderFinish(board_decoder_t *dec);
+
+#endif
@@ -0,0 +1,447 @@
+#include "kernels.h"
+
+/**
+ * Plain C kernels
+ */
+
+#if ROTATED_BOARDS
+/**
+ * Check a line (a mask with a bit per cell along it) for K in a row */
+static inline int lineHasRun(uint16_t line) {
+	uint16_t v = line;
+	for(bloc_t i = 1; i < K && v; i++) v &= line >> i;
+	return v != 0;
+}
+
+/**
+ * Check if player p's stones (0 for us, 1 for them) have K in a row in any direction
+ * Every line of every direction is a mask in one of the board's copies, so one line kernel checks them all */
+static int hasRunScalar(const board_t *b, int p) {
+	for(bloc_t x = 0; x < M; x++) {
+		if(lineHasRun(b->bits[p][x])) return 1;
+	}
+	for(bloc_t y = 0; y < N; y++) {
+		if(lineHasRun(b->rows[p][y])) return 1;
+	}
+	for(bloc_t i = 0; i < M + N - 1; i++) {
+		if(lineHasRun(b->diags[p][i]) || lineHasRun(b->antiDiags[p][i])) return 1;
+	}
+	return 0;
+}
+#else
+/**
+ * Check if player p's stones (0 for us, 1 for them) have K in a row in any direction
+ * Runs are found by shift-and-and: a bit survives anding K-1 shifted copies of the board only if it starts a run of K */
+static int hasRunScalar(const board_t *b, int p) {
+	const uint16_t *c = b->bits[p];
+	// check columns (runs along y are shifts within a column mask)
+	for(bloc_t x = 0; x < M; x++) {
+		uint16_t v = c[x];
+		for(bloc_t i = 1; i < K && v; i++) v &= c[x] >> i;
+		if(v) return 1;
+	}
+	// check rows and diagonals (runs along x and the diagonals and the next K-1 columns, shifted by the slope of the line)
+	for(bloc_t x = 0; x + K <= M; x++) {
+		uint16_t h = c[x], d = c[x], a = c[x];
+		for(bloc_t i = 1; i < K && (h | d | a); i++) {
+			h &= c[x + i];
+			d &= c[x + i] >> i;
+			a &= c[x + i] << i;
+		}
+		if(h | d | a) return 1;
+	}
+	return 0;
+}
+#endif
+
+/**
+ * Score the windows of a line, given as a mask per player with the line's cells from bit lo to bit hi */
+static inline int scoreLine(const int *scores, uint16_t us, uint16_t them, bloc_t lo, bloc_t hi) {
+	int score = 0;
+	uint16_t window = (1u << K) - 1;
+	for(bloc_t i = lo; i + K - 1 <= hi; i++) {
+		score += scores[__builtin_popcount((us >> i) & window) | __builtin_popcount((them >> i) & window) << 4];
+	}
+	return score;
+}
+
+/**
+ * Sum the scores of every K long window along a row, column, or diagonal */
+static int scoreWindowsScalar(const board_t *b, const int *scores) {
+	int finalScore = 0;
+#if ROTATED_BOARDS
+	const uint16_t (*rows)[16] = b->rows, (*diags)[32] = b->diags, (*antiDiags)[32] = b->antiDiags;
+#else
+	// masks of the rows and diagonals, with bit x set for the stone in column x
+	// diagonal x + y runs down and left, and diagonal x - y + N - 1 runs down and right
+	uint16_t rows[2][16] = {{0}}, diags[2][32] = {{0}}, antiDiags[2][32] = {{0}};
+	for(int p = 0; p < 2; p++) {
+		for(bloc_t x = 0; x < M; x++) {
+			for(uint16_t column = b->bits[p][x]; column; column &= column - 1) {
+				bloc_t y = __builtin_ctz(column);
+				rows[p][y] |= 1u << x;
+				diags[p][x + y] |= 1u << x;
+				antiDiags[p][x - y + N - 1] |= 1u << x;
+			}
+		}
+	}
+#endif
+
+	/** --- SCORE COLUMNS --- **/
+	for(bloc_t x = 0; x < M; x++) finalScore += scoreLine(scores, b->bits[0][x], b->bits[1][x], 0, N - 1);
+
+	/** --- SCORE ROWS --- **/
+	for(bloc_t y = 0; y < N; y++) finalScore += scoreLine(scores, rows[0][y], rows[1][y], 0, M - 1);
+
+	/** --- SCORE DIAGONALS --- **/
+	// both diagonal i and anti diagonal i cover columns i - (N - 1) to i (clipped to the board)
+	for(bloc_t i = 0; i < (M + N - 1); i++) {
+		bloc_t lo = i - (N - 1) > 0 ? i - (N - 1) : 0;
+		bloc_t hi = i < M - 1 ? i : M - 1;
+		finalScore += scoreLine(scores, diags[0][i], diags[1][i], lo, hi);
+	}
+	for(bloc_t i = 0; i < (M + N - 1); i++) {
+		bloc_t lo = i - (N - 1) > 0 ? i - (N - 1) : 0;
+		bloc_t hi = i < M - 1 ? i : M - 1;
+		finalScore += scoreLine(scores, antiDiags[0][i], antiDiags[1][i], lo, hi);
+	}
+
+	return finalScore;
+}
+
+static int candidatesScalar(const board_t *b, uint16_t *mask) {
+	uint16_t rows = (1u << N) - 1;
+	uint16_t near = 0;
+	for(bloc_t x = 0; x < 16; x++) {
+		mask[x] = x < M ? ~(b->bits[0][x] | b->bits[1][x]) & rows : 0;
+		near |= mask[x] & b->nearBits[x];
+	}
+	if(near) {
+		for(bloc_t x = 0; x < 16; x++) mask[x] &= b->nearBits[x];
+	}
+	return near != 0;
+}
+
+static int countEmptyScalar(const board_t *b) {
+	int res = M * N;
+	for(bloc_t x = 0; x < M; x++) {
+		res -= __builtin_popcount(b->bits[0][x] | b->bits[1][x]);
+	}
+	return res;
+}
+
+/**
+ * SSE2 kernels
+ * A bitboard is two registers of 8 columns. Moving to the next column shifts both down by a lane, carrying the first lane of the upper one over
+ */
+
+__attribute__((target("sse2")))
+static inline void nextColumnSSE2(__m128i *v) {
+	v[0] = _mm_or_si128(_mm_srli_si128(v[0], 2), _mm_slli_si128(v[1], 14));
+	v[1] = _mm_srli_si128(v[1], 2);
+}
+
+__attribute__((target("sse2")))
+static inline int isZeroSSE2(__m128i v) {
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xffff;
+}
+
+/**
+ * Same as hasRunScalar, for 8 columns at a time */
+__attribute__((target("sse2")))
+static int hasRunSSE2(const board_t *b, int p) {
+	const uint16_t *c = b->bits[p];
+	__m128i board[2] = {_mm_loadu_si128((const __m128i *)c), _mm_loadu_si128((const __m128i *)(c + 8))};
+	// runs starting in each column going down, across, and along both diagonals
+	__m128i v[2] = {board[0], board[1]}, h[2] = {board[0], board[1]}, d[2] = {board[0], board[1]}, a[2] = {board[0], board[1]};
+	__m128i next[2] = {board[0], board[1]};
+	__m128i any = _mm_or_si128(board[0], board[1]);
+	for(bloc_t i = 1; i < K && !isZeroSSE2(any); i++) {
+		__m128i shift = _mm_cvtsi32_si128(i);
+		// lane x of next is column x + i
+		nextColumnSSE2(next);
+		any = _mm_setzero_si128();
+		for(int j = 0; j < 2; j++) {
+			v[j] = _mm_and_si128(v[j], _mm_srl_epi16(board[j], shift));
+			h[j] = _mm_and_si128(h[j], next[j]);
+			d[j] = _mm_and_si128(d[j], _mm_srl_epi16(next[j], shift));
+			a[j] = _mm_and_si128(a[j], _mm_sll_epi16(next[j], shift));
+			any = _mm_or_si128(any, _mm_or_si128(_mm_or_si128(v[j], h[j]), _mm_or_si128(d[j], a[j])));
+		}
+	}
+	return !isZeroSSE2(any);
+}
+
+/**
+ * Same as scoreWindowsScalar. Stones are counted like scoreWindowsAVX2, and then scores are looked up one window at a time */
+__attribute__((target("sse2")))
+static int scoreWindowsSSE2(const board_t *b, const int *scores) {
+	static const bloc_t directions[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+	const __m128i one = _mm_set1_epi16(1);
+	int total = 0;
+	// columns[p][i] is player p's bitboard moved i columns, so lane x is column x + i
+	__m128i columns[2][16][2];
+	for(int p = 0; p < 2; p++) {
+		columns[p][0][0] = _mm_loadu_si128((const __m128i *)b->bits[p]);
+		columns[p][0][1] = _mm_loadu_si128((const __m128i *)(b->bits[p] + 8));
+		for(bloc_t i = 1; i < K; i++) {
+			columns[p][i][0] = columns[p][i - 1][0];
+			columns[p][i][1] = columns[p][i - 1][1];
+			nextColumnSSE2(columns[p][i]);
+		}
+	}
+
+	for(int d = 0; d < 4; d++) {
+		bloc_t dx = directions[d][0], dy = directions[d][1];
+		// windows have to end on the board
+		bloc_t starts = M - (K - 1) * dx;
+		bloc_t first = dy < 0 ? K - 1 : 0, last = dy > 0 ? N - K : N - 1;
+		for(bloc_t y = first; y <= last; y++) {
+			uint16_t index[16];
+			for(int j = 0; j < 2; j++) {
+				__m128i us = _mm_setzero_si128(), them = _mm_setzero_si128();
+				for(bloc_t i = 0; i < K; i++) {
+					// the window's i-th cell is at (x + i * dx, y + i * dy)
+					__m128i shift = _mm_cvtsi32_si128(y + i * dy);
+					us = _mm_add_epi16(us, _mm_and_si128(_mm_srl_epi16(columns[0][i * dx][j], shift), one));
+					them = _mm_add_epi16(them, _mm_and_si128(_mm_srl_epi16(columns[1][i * dx][j], shift), one));
+				}
+				_mm_storeu_si128((__m128i *)(index + 8 * j), _mm_or_si128(us, _mm_slli_epi16(them, 4)));
+			}
+			for(bloc_t x = 0; x < starts; x++) total += scores[index[x]];
+		}
+	}
+	return total;
+}
+
+__attribute__((target("sse2")))
+static int candidatesSSE2(const board_t *b, uint16_t *mask) {
+	const __m128i rows = _mm_set1_epi16((short)((1u << N) - 1));
+	const __m128i lanes[2] = {_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7), _mm_setr_epi16(8, 9, 10, 11, 12, 13, 14, 15)};
+	__m128i free[2], near[2];
+	__m128i any = _mm_setzero_si128();
+	for(int j = 0; j < 2; j++) {
+		__m128i occupied = _mm_or_si128(_mm_loadu_si128((const __m128i *)(b->bits[0] + 8 * j)), _mm_loadu_si128((const __m128i *)(b->bits[1] + 8 * j)));
+		__m128i onBoard = _mm_and_si128(rows, _mm_cmpgt_epi16(_mm_set1_epi16(M), lanes[j]));
+		free[j] = _mm_andnot_si128(occupied, onBoard);
+		near[j] = _mm_loadu_si128((const __m128i *)(b->nearBits + 8 * j));
+		any = _mm_or_si128(any, _mm_and_si128(free[j], near[j]));
+	}
+	int isNear = !isZeroSSE2(any);
+	for(int j = 0; j < 2; j++) {
+		if(isNear) free[j] = _mm_and_si128(free[j], near[j]);
+		_mm_storeu_si128((__m128i *)(mask + 8 * j), free[j]);
+	}
+	return isNear;
+}
+
+/**
+ * Count with a bit twiddling popcount of each 16 bit lane */
+__attribute__((target("sse2")))
+static int countEmptySSE2(const board_t *b) {
+	__m128i count = _mm_setzero_si128();
+	for(int j = 0; j < 2; j++) {
+		__m128i v = _mm_or_si128(_mm_loadu_si128((const __m128i *)(b->bits[0] + 8 * j)), _mm_loadu_si128((const __m128i *)(b->bits[1] + 8 * j)));
+		v = _mm_sub_epi16(v, _mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi16(0x5555)));
+		v = _mm_add_epi16(_mm_and_si128(v, _mm_set1_epi16(0x3333)), _mm_and_si128(_mm_srli_epi16(v, 2), _mm_set1_epi16(0x3333)));
+		v = _mm_and_si128(_mm_add_epi16(v, _mm_srli_epi16(v, 4)), _mm_set1_epi16(0x0f0f));
+		// add up the bytes
+		count = _mm_add_epi64(count, _mm_sad_epu8(v, _mm_setzero_si128()));
+	}
+	count = _mm_add_epi64(count, _mm_unpackhi_epi64(count, count));
+	return M * N - _mm_cvtsi128_si32(count);
+}
+
+/**
+ * AVX2 kernels
+ * Lane x of a register is column x. Runs along a column are bit shifts within each lane (vpsrlw)
+ * Runs along rows and diagonals move one lane per step, done with an alignr against the register's upper half
+ */
+
+/**
+ * Move every lane down by one, so lane x holds what was in lane x + 1 (and lane 15 is blank) */
+__attribute__((target("avx2")))
+static inline __m256i nextColumnAVX2(__m256i v) {
+	return _mm256_alignr_epi8(_mm256_permute2x128_si256(v, v, 0x81), v, 2);
+}
+
+/**
+ * Same as hasRunScalar, for all 16 columns at once */
+__attribute__((target("avx2")))
+static int hasRunAVX2(const board_t *b, int p) {
+	const uint16_t *c = b->bits[p];
+	__m256i board = _mm256_loadu_si256((const __m256i *)c);
+	// runs starting in each column going down, across, and along both diagonals
+	__m256i v = board, h = board, d = board, a = board;
+	__m256i next = board;
+	for(bloc_t i = 1; i < K; i++) {
+		__m128i shift = _mm_cvtsi32_si128(i);
+		// lane x of next is column x + i
+		next = nextColumnAVX2(next);
+		v = _mm256_and_si256(v, _mm256_srl_epi16(board, shift));
+		h = _mm256_and_si256(h, next);
+		d = _mm256_and_si256(d, _mm256_srl_epi16(next, shift));
+		a = _mm256_and_si256(a, _mm256_sll_epi16(next, shift));
+		__m256i any = _mm256_or_si256(_mm256_or_si256(v, h), _mm256_or_si256(d, a));
+		if(_mm256_testz_si256(any, any)) return 0;
+	}
+	__m256i any = _mm256_or_si256(_mm256_or_si256(v, h), _mm256_or_si256(d, a));
+	return !_mm256_testz_si256(any, any);
+}
+
+/**
+ * Same as scoreWindowsScalar
+ * For each direction and each row y that windows can start on, the stones of the windows starting at (x, y) are counted in lane x of a register,
+ * and the scores for all 16 columns are gathered at once */
+__attribute__((target("avx2")))
+static int scoreWindowsAVX2(const board_t *b, const int *scores) {
+	static const bloc_t directions[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+	const __m256i one = _mm256_set1_epi16(1);
+	const __m256i lanes = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m256i total = _mm256_setzero_si256();
+	// lane x of columns[p][i] is column x + i of player p's bitboard
+	__m256i columns[2][16];
+	columns[0][0] = _mm256_loadu_si256((const __m256i *)b->bits[0]);
+	columns[1][0] = _mm256_loadu_si256((const __m256i *)b->bits[1]);
+	for(bloc_t i = 1; i < K; i++) {
+		columns[0][i] = nextColumnAVX2(columns[0][i - 1]);
+		columns[1][i] = nextColumnAVX2(columns[1][i - 1]);
+	}
+
+	for(int d = 0; d < 4; d++) {
+		bloc_t dx = directions[d][0], dy = directions[d][1];
+		// windows have to end on the board
+		__m256i valid = _mm256_cmpgt_epi16(_mm256_set1_epi16(M - (K - 1) * dx), lanes);
+		__m256i validLow = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(valid));
+		__m256i validHigh = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(valid, 1));
+		bloc_t first = dy < 0 ? K - 1 : 0, last = dy > 0 ? N - K : N - 1;
+		for(bloc_t y = first; y <= last; y++) {
+			__m256i us = _mm256_setzero_si256(), them = _mm256_setzero_si256();
+			for(bloc_t i = 0; i < K; i++) {
+				// the window's i-th cell is at (x + i * dx, y + i * dy)
+				__m128i shift = _mm_cvtsi32_si128(y + i * dy);
+				us = _mm256_add_epi16(us, _mm256_and_si256(_mm256_srl_epi16(columns[0][i * dx], shift), one));
+				them = _mm256_add_epi16(them, _mm256_and_si256(_mm256_srl_epi16(columns[1][i * dx], shift), one));
+			}
+			__m256i index = _mm256_or_si256(us, _mm256_slli_epi16(them, 4));
+			__m256i low = _mm256_i32gather_epi32(scores, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(index)), 4);
+			__m256i high = _mm256_i32gather_epi32(scores, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(index, 1)), 4);
+			total = _mm256_add_epi32(total, _mm256_and_si256(low, validLow));
+			total = _mm256_add_epi32(total, _mm256_and_si256(high, validHigh));
+		}
+	}
+
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+	return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("avx2")))
+static int candidatesAVX2(const board_t *b, uint16_t *mask) {
+	const __m256i lanes = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m256i occupied = _mm256_or_si256(_mm256_loadu_si256((const __m256i *)b->bits[0]), _mm256_loadu_si256((const __m256i *)b->bits[1]));
+	__m256i onBoard = _mm256_and_si256(_mm256_set1_epi16((short)((1u << N) - 1)), _mm256_cmpgt_epi16(_mm256_set1_epi16(M), lanes));
+	__m256i free = _mm256_andnot_si256(occupied, onBoard);
+	__m256i near = _mm256_loadu_si256((const __m256i *)b->nearBits);
+	int isNear = !_mm256_testz_si256(free, near);
+	if(isNear) free = _mm256_and_si256(free, near);
+	_mm256_storeu_si256((__m256i *)mask, free);
+	return isNear;
+}
+
+/**
+ * Count with a popcount of each byte, looking up each half in a table of 16 with vpshufb */
+__attribute__((target("avx2")))
+static int countEmptyAVX2(const board_t *b) {
+	const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low = _mm256_set1_epi8(0x0f);
+	__m256i v = _mm256_or_si256(_mm256_loadu_si256((const __m256i *)b->bits[0]), _mm256_loadu_si256((const __m256i *)b->bits[1]));
+	__m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(v, low)), _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+	// add up the bytes
+	__m256i count = _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+	__m128i sum = _mm_add_epi64(_mm256_castsi256_si128(count), _mm256_extracti128_si256(count, 1));
+	sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+	return M * N - _mm_cvtsi128_si32(sum);
+}
+
+/**
+ * AVX-512 kernels
+ * Both players' bitboards fit in one register (ours in lanes 0-15, theirs in 16-31), and a gather scores 16 windows at once
+ * The other kernels gain nothing from the wider registers, so the AVX-512 set uses the AVX2 ones for them
+ */
+
+/**
+ * Same as scoreWindowsScalar */
+__attribute__((target("avx512f,avx512bw")))
+static int scoreWindowsAVX512(const board_t *b, const int *scores) {
+	static const bloc_t directions[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+	// moves each player's lanes down by one column, blanking the last
+	static const uint16_t nextLane[32] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 0};
+	const __m512i next = _mm512_loadu_si512(nextLane);
+	const __m512i one = _mm512_set1_epi16(1);
+	__m512i total = _mm512_setzero_si512();
+	// lane x of columns[i] is column x + i (of each player)
+	__m512i columns[16];
+	columns[0] = _mm512_loadu_si512(b->bits);
+	for(bloc_t i = 1; i < K; i++) columns[i] = _mm512_maskz_permutexvar_epi16(0x7fff7fff, next, columns[i - 1]);
+
+	for(int d = 0; d < 4; d++) {
+		bloc_t dx = directions[d][0], dy = directions[d][1];
+		// windows have to end on the board
+		bloc_t starts = M - (K - 1) * dx;
+		__mmask16 valid = starts > 0 ? (1u << starts) - 1 : 0;
+		bloc_t first = dy < 0 ? K - 1 : 0, last = dy > 0 ? N - K : N - 1;
+		for(bloc_t y = first; y <= last; y++) {
+			__m512i count = _mm512_setzero_si512();
+			for(bloc_t i = 0; i < K; i++) {
+				// the window's i-th cell is at (x + i * dx, y + i * dy)
+				__m128i shift = _mm_cvtsi32_si128(y + i * dy);
+				count = _mm512_add_epi16(count, _mm512_and_si512(_mm512_srl_epi16(columns[i * dx], shift), one));
+			}
+			__m256i index = _mm256_or_si256(_mm512_castsi512_si256(count), _mm256_slli_epi16(_mm512_extracti64x4_epi64(count, 1), 4));
+			total = _mm512_add_epi32(total, _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), valid, _mm512_cvtepu16_epi32(index), scores, 4));
+		}
+	}
+	return _mm512_reduce_add_epi32(total);
+}
+
+/**
+ * Kernel selection
+ */
+
+static const kernels_t kernelSets[] = {
+	{"c", hasRunScalar, scoreWindowsScalar, candidatesScalar, countEmptyScalar},
+	{"sse2", hasRunSSE2, scoreWindowsSSE2, candidatesSSE2, countEmptySSE2},
+	{"avx2", hasRunAVX2, scoreWindowsAVX2, candidatesAVX2, countEmptyAVX2},
+	{"avx512", hasRunAVX2, scoreWindowsAVX512, candidatesAVX2, countEmptyAVX2},
+};
+#define KERNEL_SETS ((int)(sizeof(kernelSets) / sizeof(kernelSets[0])))
+
+kernels_t kernels;
+
+/**
+ * Check (with CPUID) if the CPU can run a set of kernels */
+static int kernelsSupported(const kernels_t *set) {
+	__builtin_cpu_init();
+	if(!strcmp(set->name, "sse2")) return __builtin_cpu_supports("sse2");
+	if(!strcmp(set->name, "avx2")) return __builtin_cpu_supports("avx2");
+	if(!strcmp(set->name, "avx512")) return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+	return 1;
+}
+
+/**
+ * Use the set of kernels called name (c, sse2, avx2, or avx512), or the widest one the CPU supports if name is NULL
+ * Returns nonzero if there is no such set, or the CPU can't run it */
+int selectKernels(const char *name) {
+	for(int i = KERNEL_SETS - 1; i >= 0; i--) {
+		if(name != NULL && strcmp(name, kernelSets[i].name)) continue;
+		if(!kernelsSupported(&kernelSets[i])) {
+			if(name != NULL) return 1;
+			continue;
+		}
+		kernels = kernelSets[i];
+		return 0;
+	}
+	return 1;
+}
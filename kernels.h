@@ -0,0 +1,35 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "board.h"
+
+/**
+ * Kernels for scans over a whole board, with a version per instruction set
+ * A player's bitboard (board_t.bits[p]) is 16 columns of 16 bits, which is two SSE2 registers or one AVX2 register of 16 bit lanes
+ * Every version of a kernel gives identical results
+ *
+ * The binary is built for any x86-64 CPU, and the widest set of kernels the CPU supports is picked at run time (see selectKernels)
+ * The search doesn't scan whole boards for wins or the evaluation: those are kept up to date by makeMove and unmakeMove (see board.c)
+ * hasRun and scoreWindows are for syncBoard, and for checking the incremental versions (make DEBUG=1). candidates is used by getCandidates
+ */
+typedef struct {
+	// c, sse2, avx2, or avx512
+	const char *name;
+	// check if player p's stones (0 for us, 1 for them) have K in a row in any direction
+	int (*hasRun)(const board_t *b, int p);
+	// sum the scores of every K long window along a row, column, or diagonal
+	// scores is indexed by the stones in a window, ours | theirs << 4 (see windowScore in board.c)
+	int (*scoreWindows)(const board_t *b, const int *scores);
+	// set mask to the candidate moves (empty cells near a stone, or every empty cell if none are), one uint16_t per column
+	// returns nonzero if some empty cell is near a stone
+	int (*candidates)(const board_t *b, uint16_t *mask);
+	// count the empty cells in the M x N board
+	int (*countEmpty)(const board_t *b);
+} kernels_t;
+
+// the kernels in use. syncBoard picks them if selectKernels hasn't been called
+extern kernels_t kernels;
+
+int selectKernels(const char *name);
+
+#endif
@@ -1,171 +1,174 @@
-#include <json.h>
 #include <curl/curl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include "board.h"
+#include "decode.h"
+#include "kernels.h"
 #include <unistd.h>
 
-int json_board_callback(void *board, int type, const char *data, uint32_t length)
+/**
+ * Feed a chunk of a board response to its decoder, as curl receives it */
+static size_t boardWriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
 {
-  // 0 for m, 1 for n, 2 for k, 3 for board
-	static int lastParam = -1;
-  static int x = 0;
-  static int y = 0;
-
-	switch (type) {
-	case JSON_ARRAY_END:
-		y = 0;
-    x++;
-		break;
-	case JSON_KEY:
-    if(!strncmp(data, "m", length)) lastParam = 0;
-    else if(!strncmp(data, "n", length)) lastParam = 1;
-    else if(!strncmp(data, "k", length)) lastParam = 2;
-    else if(!strncmp(data, "board", length)) lastParam = 3;
-    else lastParam = -1;
-    break;
-	case JSON_INT:
-    if(lastParam == 0) M = strtol(data, NULL, 10);
-    if(lastParam == 1) N = strtol(data, NULL, 10);
-    if(lastParam == 2) K = strtol(data, NULL, 10);
-    if(lastParam == 3) {
-      int cell = strtol(data, NULL, 10);
-      if(cell == -1) ((board_t*)board)->board[x][y] = 0;
-      if(cell == 0) ((board_t*)board)->board[x][y] = 1;
-      if(cell == 1) ((board_t*)board)->board[x][y] = 2;
-      if(x >= M || y >= N) fprintf(stderr, "board data exceeded M and N\n");
-      y++;
-    }
-    break;
-  case JSON_OBJECT_END:
-    lastParam = -1;
-    x = 0;
-    y = 0;
-    break;
-	case JSON_NULL:
-		((board_t*)board)->board[0][0] = 8;
-  case JSON_ARRAY_BEGIN:
-  case JSON_OBJECT_BEGIN:
-    break;
-	default:
-    fprintf(stderr, "Unexpected JSON atom type\n");
-	}
-
-  return 0;
+  size_t realsize = size * nmemb;
+  if(decoderFeed((board_decoder_t *)userp, (const char *)contents, realsize)) return 0;
+  return realsize;
 }
 
+// signature of curl's CURLOPT_WRITEFUNCTION
+typedef size_t (*write_callback_t)(void *contents, size_t size, size_t nmemb, void *userp);
+
 /**
- * Handle loading data into memory with libcurl
- */
-struct MemoryStruct {
-  char *memory;
-  size_t size;
-};
- 
+ * HTTP client for the game server
+ * One curl handle is kept for the life of the program, so its connection to the server stays open and is reused by every request (HTTP keep-alive)
+ * The request URLs and the constant part of the move body are built once, and responses are read into a buffer that only grows,
+ * so a request allocates nothing */
+typedef struct {
+  CURL *curl;
+  char *boardUrl;
+  char *moveUrl;
+  char *nameUrl;
+  char *key;
+  // body of a move request: "key=...&" followed by the move, written at moveBodyPrefix
+  char *moveBody;
+  size_t moveBodyPrefix;
+  size_t moveBodySize;
+  // body of the last response (null terminated), and the size allocated for it
+  char *response;
+  size_t responseSize;
+  size_t responseCapacity;
+} client_t;
+
 static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp)
 {
   size_t realsize = size * nmemb;
-  struct MemoryStruct *mem = (struct MemoryStruct *)userp;
- 
-  char *ptr = realloc(mem->memory, mem->size + realsize + 1);
-  if(ptr == NULL) {
-    /* out of memory! */ 
-    printf("not enough memory (realloc returned NULL)\n");
-    return 0;
+  client_t *client = (client_t *)userp;
+
+  if(client->responseSize + realsize + 1 > client->responseCapacity) {
+    size_t capacity = client->responseCapacity * 2;
+    while(capacity < client->responseSize + realsize + 1) capacity *= 2;
+    char *ptr = realloc(client->response, capacity);
+    if(ptr == NULL) {
+      /* out of memory! */ 
+      printf("not enough memory (realloc returned NULL)\n");
+      return 0;
+    }
+    client->response = ptr;
+    client->responseCapacity = capacity;
   }
- 
-  mem->memory = ptr;
-  memcpy(&(mem->memory[mem->size]), contents, realsize);
-  mem->size += realsize;
-  mem->memory[mem->size] = 0;
- 
+
+  memcpy(&(client->response[client->responseSize]), contents, realsize);
+  client->responseSize += realsize;
+  client->response[client->responseSize] = 0;
+
   return realsize;
 }
 
 /**
- * Load a board from the api, set M, N, and K
- * Returns nonzero on failure, 0 on success */
-int loadBoard(board_t *board, const char * url, const char * key) {
-  char * finalUrl = malloc(strlen(url) + strlen(key) + 16);
-  sprintf(finalUrl, "%s/api/board?key=%s", url, key);
-  /* make http request */
-  CURL *curl;
-  curl = curl_easy_init();
+ * Set up a client for the server at url, playing as key
+ * If longPoll is nonzero, board requests ask the server to hold the request for up to longPoll ms until there is a board (the wait parameter)
+ * Returns nonzero on failure */
+int clientInit(client_t *client, const char *url, const char *key, int longPoll) {
+  memset(client, 0, sizeof(client_t));
+  if(curl_global_init(CURL_GLOBAL_DEFAULT)) return 1;
+  client->curl = curl_easy_init();
+  if(client->curl == NULL) return 1;
 
-  struct MemoryStruct chunk;
-  chunk.memory = malloc(1);
-  chunk.size = 0;
+  client->boardUrl = malloc(strlen(url) + strlen(key) + 32);
+  client->moveUrl = malloc(strlen(url) + 10);
+  client->nameUrl = malloc(strlen(url) + 14);
+  client->key = strdup(key);
+  // room for "key=", the key, and "&x=...&y=..." with two numbers
+  client->moveBodySize = strlen(key) + 64;
+  client->moveBody = malloc(client->moveBodySize);
+  client->responseCapacity = 1024;
+  client->response = malloc(client->responseCapacity);
+  if(!client->boardUrl || !client->moveUrl || !client->nameUrl || !client->key || !client->moveBody || !client->response) return 1;
+  if(longPoll) sprintf(client->boardUrl, "%s/api/board?key=%s&wait=%i", url, key, longPoll);
+  else sprintf(client->boardUrl, "%s/api/board?key=%s", url, key);
+  sprintf(client->moveUrl, "%s/api/move", url);
+  sprintf(client->nameUrl, "%s/api/set_name", url);
+  client->moveBodyPrefix = sprintf(client->moveBody, "key=%s&", key);
 
-  curl_easy_setopt(curl, CURLOPT_URL, finalUrl);
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(curl, CURLOPT_HTTPGET, 1);
+  curl_easy_setopt(client->curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(client->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(client->curl, CURLOPT_TCP_NODELAY, 1L);
+  // give up on a held request a while after the server should have answered it
+  if(longPoll) curl_easy_setopt(client->curl, CURLOPT_TIMEOUT_MS, (long)longPoll + 5000);
+  return 0;
+}
 
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
+/**
+ * Close the client's connection and free it */
+void clientFree(client_t *client) {
+  if(client->curl != NULL) curl_easy_cleanup(client->curl);
+  free(client->boardUrl);
+  free(client->moveUrl);
+  free(client->nameUrl);
+  free(client->key);
+  free(client->moveBody);
+  free(client->response);
+  memset(client, 0, sizeof(client_t));
+  curl_global_cleanup();
+}
 
-  int res = curl_easy_perform(curl);
+/**
+ * Send a GET (if body is NULL) or a POST of body to url
+ * The response is passed to write with writeData (as curl's CURLOPT_WRITEFUNCTION), or read into client->response if write is NULL
+ * Returns nonzero on failure */
+static int clientRequest(client_t *client, const char *url, const char *body, write_callback_t write, void *writeData) {
+  client->responseSize = 0;
+  client->response[0] = 0;
+  curl_easy_setopt(client->curl, CURLOPT_WRITEFUNCTION, write != NULL ? write : WriteMemoryCallback);
+  curl_easy_setopt(client->curl, CURLOPT_WRITEDATA, write != NULL ? writeData : (void *)client);
+  curl_easy_setopt(client->curl, CURLOPT_URL, url);
+  if(body == NULL) curl_easy_setopt(client->curl, CURLOPT_HTTPGET, 1L);
+  else curl_easy_setopt(client->curl, CURLOPT_POSTFIELDS, body);
+  int res = curl_easy_perform(client->curl);
   if(res != CURLE_OK) {
-    curl_easy_cleanup(curl);
-    free(finalUrl);
     fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-    free(chunk.memory);
-    return 1;
-  }
-  curl_easy_cleanup(curl);
-  free(finalUrl);
-  if(!strncmp(chunk.memory, "null", 4)) {
-    free(chunk.memory);
     return 1;
   }
+  return 0;
+}
 
-  json_parser parser;
-  if(json_parser_init(&parser, NULL, &json_board_callback, board)) {
-    fprintf(stderr, "Failed to initialize JSON parser\n");
-    return 1;
-  }
-  memset(board, 0, sizeof(board_t));
-  int ret;
-  if((ret = json_parser_string(&parser, chunk.memory, chunk.size, NULL))) {
-    fprintf(stderr, "Failed to parse JSON data %i\n", ret);
-    json_parser_free(&parser);
-    free(chunk.memory);
+/**
+ * Load a board from the api, set M, N, and K (stopping any pondering first)
+ * The response is decoded as it arrives, without being buffered (see decode.c)
+ * Returns nonzero on failure, 0 on success */
+int loadBoard(client_t *client, board_t *board) {
+  board_decoder_t dec;
+  decoderInit(&dec, board, 0);
+  int failed = clientRequest(client, client->boardUrl, NULL, boardWriteCallback, &dec);
+  // a null board was returned, or it couldn't be read
+  if(decoderFinish(&dec) || failed) {
+    memset(board, 0, sizeof(board_t));
     return 1;
   }
-  free(chunk.memory);
-  json_parser_free(&parser);
-  // parser is indicating a null board was returned
-  if(board->board[0][0] == 8) {
+  // the decoder only accepts sizes of 1 to 15. One left out keeps the last board's, so the first board has to give all three
+  if(!(dec.m ? dec.m : M) || !(dec.n ? dec.n : N) || !(dec.k ? dec.k : K)) {
+    fprintf(stderr, "Board size missing\n");
     memset(board, 0, sizeof(board_t));
     return 1;
   }
+  // nothing may search while M, N, and K change
+  ponderStop();
+  if(dec.m) M = dec.m;
+  if(dec.n) N = dec.n;
+  if(dec.k) K = dec.k;
+  syncBoard(board);
   return 0;
 }
 
 /**
  * Set the ai's name */
-void setName(char * name, char * url, char * key) {
+void setName(client_t *client, char * name) {
   printf("Setting Name: %s --- ", name);
-  char * finalUrl = malloc(strlen(url) + 14);
-  char * options = malloc(strlen(name) + strlen(key) + 11);
-  sprintf(options, "key=%s&name=%s", key, name);
-  sprintf(finalUrl, "%s/api/set_name", url);
-
-  CURL *curl;
-  curl = curl_easy_init();
-
-  curl_easy_setopt(curl, CURLOPT_URL, finalUrl);
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(curl, CURLOPT_HTTPPOST, 1);
-  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, options);
+  char * options = malloc(strlen(name) + strlen(client->key) + 11);
+  sprintf(options, "key=%s&name=%s", client->key, name);
 
-  int res = curl_easy_perform(curl);
+  if(!clientRequest(client, client->nameUrl, options, NULL, NULL)) printf("%s", client->response);
 
-  if(res != CURLE_OK)
-      fprintf(stderr, "curl_easy_perform() failed: %s\n",
-              curl_easy_strerror(res));
-
-  curl_easy_cleanup(curl);
-  free(finalUrl);
   free(options);
   printf("\n");
 }
@@ -173,94 +176,210 @@ void setName(char * name, char * url, char * key) {
 /**
  * send a move to the server
  * If board is not null, it will be printed with the move indicated */
-void postMove(bloc_t x, bloc_t y, char *url, char *key, board_t *board) {
-  if(board != NULL) {
-    board_t scratch;
-    memcpy(&scratch, board, sizeof(board_t));
-    scratch.board[x][y] = PLAYER_TIE;
-    printBoard(&scratch);
-  }
+void postMove(client_t *client, bloc_t x, bloc_t y, board_t *board) {
+  if(board != NULL) printBoardWithMove(board, x, y);
   printf("Sending Move: (%li, %li) --- ", x, y);
-  char * finalUrl = malloc(strlen(url) + 10);
-  char * options = malloc(strlen(key) + 15);
-  sprintf(options, "key=%s&x=%li&y=%li", key, x, y);
-  sprintf(finalUrl, "%s/api/move", url);
+  snprintf(client->moveBody + client->moveBodyPrefix, client->moveBodySize - client->moveBodyPrefix, "x=%li&y=%li", x, y);
 
-  CURL *curl;
-  curl = curl_easy_init();
+  if(!clientRequest(client, client->moveUrl, client->moveBody, NULL, NULL)) printf("%s", client->response);
 
-  curl_easy_setopt(curl, CURLOPT_URL, finalUrl);
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(curl, CURLOPT_HTTPPOST, 1);
-  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, options);
+  printf("\n");
+}
 
-  int res = curl_easy_perform(curl);
+/**
+ * Polling scheduler
+ * Right after we move, the board is polled every fastInterval ms, since the opponent may answer quickly
+ * Each poll that finds no board doubles the interval, up to maxInterval, so a long think or no game at all costs few requests
+ * With long polling the server holds a poll until there is a board, so if it held the last one the next goes out right away
+ * A server that doesn't long poll answers at once, and the backoff applies as usual */
+typedef struct {
+  int fastInterval;
+  int maxInterval;
+  int longPoll;
+  // delay before the next poll (ms)
+  int interval;
+  // when the current wait for a board started (we moved or the first empty poll), and the number of polls since (-1 if not waiting)
+  int64_t waitStart;
+  int polls;
+} poller_t;
 
-  if(res != CURLE_OK)
-      fprintf(stderr, "curl_easy_perform() failed: %s\n",
-              curl_easy_strerror(res));
+void pollerInit(poller_t *poller, int fastInterval, int maxInterval, int longPoll) {
+  poller->fastInterval = fastInterval;
+  poller->maxInterval = maxInterval;
+  poller->longPoll = longPoll;
+  poller->interval = fastInterval;
+  poller->polls = -1;
+}
 
-  curl_easy_cleanup(curl);
-  free(finalUrl);
-  free(options);
-  printf("\n");
+/**
+ * Call after answering a board (posting a move): poll fast again */
+void pollerMoved(poller_t *poller) {
+  poller->interval = poller->fastInterval;
+  poller->waitStart = timeMs();
+  poller->polls = 0;
 }
 
-int calculateDepth(int openNodes, int maxNodesSearched) {
-  int searched = openNodes;
-  for(int i = 1; i < 20; i++) {
-    if(openNodes == 0) return i - 1;
-    if(searched >= maxNodesSearched) return i - 1;
-    searched *= --openNodes;
+/**
+ * Call when a poll found no board. requestTime is how long the poll took (ms)
+ * Waits until the next poll should be sent */
+void pollerEmpty(poller_t *poller, int64_t requestTime) {
+  if(poller->polls == -1) {
+    poller->waitStart = timeMs() - requestTime;
+    poller->polls = 0;
   }
-  return 20;
+  if(poller->polls++ == 0) printf("No Board to Solve\n");
+  // the server held the request, so it long polls
+  if(poller->longPoll && requestTime * 2 >= poller->longPoll) return;
+  usleep(poller->interval * 1000);
+  poller->interval *= 2;
+  if(poller->interval > poller->maxInterval) poller->interval = poller->maxInterval;
+}
+
+/**
+ * Call when a poll found a board. Reports how long we waited for it */
+void pollerBoard(poller_t *poller) {
+  if(poller->polls != -1) printf("Waited %lims for board (%i polls)\n", (long)(timeMs() - poller->waitStart), poller->polls + 1);
+  poller->polls = -1;
 }
 
-#define MAX_MINIMAX_SEARCH_NODES 8000000
+// default time to spend on minimax per move (ms)
+#define MINIMAX_TIME_LIMIT 2000
+// default size of the minimax transposition table (MB)
+#define TT_MEGABYTES 64
+// default polling intervals (ms): right after we move, and the most the backoff goes to
+#define POLL_FAST_INTERVAL 50
+#define POLL_MAX_INTERVAL 1000
 
 int main(int argc, char ** argv) {
-  if(argc < 3) {
-    fprintf(stderr, "Usage: mnk url key\n");
+  int timeLimit = MINIMAX_TIME_LIMIT;
+  int threads = 1;
+  int ponder = 1;
+  int fastInterval = POLL_FAST_INTERVAL;
+  int maxInterval = POLL_MAX_INTERVAL;
+  int longPoll = 0;
+  int ttMegabytes = TT_MEGABYTES;
+  // set of kernels to use (NULL for the widest this CPU supports)
+  const char *kernelSet = NULL;
+  int opt;
+  while((opt = getopt(argc, argv, "t:r:j:m:i:s:Pf:b:l:")) != -1) {
+    switch(opt) {
+      case 't':
+        timeLimit = strtol(optarg, NULL, 10);
+        break;
+      case 'r':
+        candidateRadius = strtol(optarg, NULL, 10);
+        // the threat search only plays candidates, and the cells defending a threat can be 2 away from every stone
+        if(candidateRadius < 2) {
+          fprintf(stderr, "Candidate radius must be at least 2\n");
+          return 1;
+        }
+        break;
+      case 'j':
+        threads = strtol(optarg, NULL, 10);
+        break;
+      case 'P':
+        ponder = 0;
+        break;
+      case 'f':
+        fastInterval = strtol(optarg, NULL, 10);
+        break;
+      case 'b':
+        maxInterval = strtol(optarg, NULL, 10);
+        break;
+      case 'l':
+        longPoll = strtol(optarg, NULL, 10);
+        break;
+      case 'm':
+        if(setSearchMode(optarg)) {
+          fprintf(stderr, "Unknown search mode %s (expected root, lazy, or ybwc)\n", optarg);
+          return 1;
+        }
+        break;
+      case 'i':
+        kernelSet = optarg;
+        break;
+      case 's':
+        ttMegabytes = strtol(optarg, NULL, 10);
+        break;
+      default:
+        fprintf(stderr, "Usage: mnk [-t time_ms] [-r candidate_radius] [-j threads] [-m root|lazy|ybwc] [-i c|sse2|avx2|avx512] [-s tt_megabytes] [-P] [-f fast_poll_ms] [-b max_poll_ms] [-l long_poll_ms] url key\n");
+        return 1;
+    }
+  }
+  if(argc - optind < 2) {
+    fprintf(stderr, "Usage: mnk [-t time_ms] [-r candidate_radius] [-j threads] [-m root|lazy|ybwc] [-i c|sse2|avx2|avx512] [-s tt_megabytes] [-P] [-f fast_poll_ms] [-b max_poll_ms] [-l long_poll_ms] url key\n");
     return 1;
   }
+  char *url = argv[optind];
+  char *key = argv[optind + 1];
+
   board_t b;
   memset(&b, 0, sizeof(board_t));
   bloc_t x, y;
 
-  setName("Wawrzynek Minimax", argv[1], argv[2]);
+  client_t client;
+  if(clientInit(&client, url, key, longPoll)) {
+    fprintf(stderr, "Failed to set up HTTP client\n");
+    return 1;
+  }
+
+  if(ttMegabytes < 0 || ttResize(ttMegabytes)) {
+    fprintf(stderr, "Failed to allocate a %iMB transposition table\n", ttMegabytes);
+    return 1;
+  }
+  if(setSearchThreads(threads)) {
+    fprintf(stderr, "Failed to start %i search threads\n", threads);
+    return 1;
+  }
+  if(selectKernels(kernelSet)) {
+    fprintf(stderr, "Can't use the %s kernels (expected c, sse2, avx2, or avx512, and one this CPU supports)\n", kernelSet);
+    return 1;
+  }
+  printf("Using %s kernels\n", kernels.name);
+
+  setName(&client, "Wawrzynek Minimax");
 
+  poller_t poller;
+  pollerInit(&poller, fastInterval, maxInterval, longPoll);
   while(1) {
-    if(!loadBoard(&b, argv[1], argv[2])) {
+    int64_t polled = timeMs();
+    if(!loadBoard(&client, &b)) {
+      pollerBoard(&poller);
+      if(ponder && ponderHit(&b)) printf("Ponder Hit\n");
+      int moved = 1;
       printf("Solving Board:\n");
       printBoard(&b);
       if(basicSolve(&b, &x, &y)) {
         printf("BasicSolve Found Move\n");
-        postMove(x, y, argv[1], argv[2], &b);
+        postMove(&client, x, y, &b);
       } else {
         printf("BasicSolve Didn't Find Move\n");
-        // calculate depth for minimax
-        int depth = calculateDepth(countEmpty(&b), MAX_MINIMAX_SEARCH_NODES);
-        printf("Doing minimax with depth=%i\n", depth);
-        if(minimaxMove(&b, &x, &y, depth)) {
+        printf("Doing minimax for %ims\n", timeLimit);
+        if(minimaxMove(&b, &x, &y, b.empty, timeLimit)) {
           printf("Minimax Found Move\n");
-          postMove(x, y, argv[1], argv[2], &b);
+          postMove(&client, x, y, &b);
         } else {
           printf("Minimax Didn't find move\n");
           if(higestScoredMove(&b, &x, &y)) {
             printf("HigestScore Found Move\n");
-            postMove(x, y, argv[1], argv[2], &b);
+            postMove(&client, x, y, &b);
           } else {
             printf("HigestScore Didn't Find Move\n");
             if(backUpMove(&b, &x, &y)) {
               printf("BackUp Found Move\n");
-              postMove(x, y, argv[1], argv[2], &b);
-            } else printf("BackUp Didn't Find Move. Giving Up\n");
+              postMove(&client, x, y, &b);
+            } else {
+              printf("BackUp Didn't Find Move. Giving Up\n");
+              moved = 0;
+            }
           }
         }
       }
+      // think about our next move while the opponent thinks about theirs
+      if(ponder && moved) ponderStart(&b, x, y);
+      pollerMoved(&poller);
     } else {
-      printf("No Board to Solve\n");
+      pollerEmpty(&poller, timeMs() - polled);
     }
-    sleep(1);
   }
 }
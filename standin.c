@@ -0,0 +1,418 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/**
+ * Local stand-in for the game server, and a latency harness for the mnk client
+ * Serves /api/board, /api/move, and /api/set_name on 127.0.0.1 from a script of boards, starts mnk against it, and
+ * reports how long the client took to answer each board
+ *
+ * The script is a list of boards. Each is a line "M N K" followed by N rows of M cells: x (us), o (them), or . (empty)
+ * Blank lines and lines starting with # are skipped
+ * The first board is available at once. Each later one becomes available oppTime ms after the move for the one before it is posted
+ * Until then /api/board returns null (or, if the poll has a wait parameter, is held until the board is available or wait ms pass)
+ * Once every board is answered, mnk is stopped and the report is printed
+ *
+ * For each board the report has:
+ *   poll_to_post: from the poll that returned the board to the move post arriving (search and posting)
+ *   ready_to_post: from the board being available to the move post arriving (polling delay too)
+ *
+ * Build: make standin
+ * Usage: standin [-d delay_ms] [-o opponent_ms] [-T timeout_ms] script mnk_path [mnk options]
+ *   delay_ms is added to every response (default 0), opponent_ms is the opponent's think time (default 100)
+ *   timeout_ms is how long to wait for a move before giving up (default 30000)
+ *   the url and key are appended to the mnk options
+ */
+
+#define MAX_BOARDS 1024
+#define MAX_CONNECTIONS 16
+#define REQUEST_SIZE 8192
+#define KEY "standin"
+
+typedef struct {
+	int m, n, k;
+	// cells[x][y]: -1 empty, 0 us, 1 them (as the server sends them)
+	int8_t cells[15][15];
+	// when the board became available, was served, and was answered (ms), and the move
+	int64_t ready, served, posted;
+	int moveX, moveY;
+} script_board_t;
+
+static script_board_t boards[MAX_BOARDS];
+static int boardCount = 0;
+// board being waited on (boardCount once all are answered)
+static int current = 0;
+
+typedef struct {
+	int fd;
+	char request[REQUEST_SIZE];
+	size_t length;
+	// a held board poll: set with the time it gives up at
+	int holding;
+	int64_t holdUntil;
+} connection_t;
+
+static connection_t connections[MAX_CONNECTIONS];
+static int delayMs = 0;
+
+static int64_t nowMs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Read the script of boards
+ * Returns nonzero on failure */
+static int loadScript(const char *path) {
+	FILE *f = fopen(path, "r");
+	if(f == NULL) {
+		fprintf(stderr, "Can't open script %s\n", path);
+		return 1;
+	}
+	char line[256];
+	int row = -1;
+	script_board_t *b = NULL;
+	while(fgets(line, sizeof(line), f)) {
+		if(line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+		if(row == -1) {
+			if(boardCount == MAX_BOARDS) break;
+			b = &boards[boardCount];
+			if(sscanf(line, "%i %i %i", &b->m, &b->n, &b->k) != 3 || b->m < 1 || b->m > 15 || b->n < 1 || b->n > 15 || b->k < 1) {
+				fprintf(stderr, "Bad board header in script: %s", line);
+				fclose(f);
+				return 1;
+			}
+			row = 0;
+			continue;
+		}
+		for(int x = 0; x < b->m; x++) {
+			char c = line[x];
+			if(c != 'x' && c != 'o' && c != '.') {
+				fprintf(stderr, "Bad row %i of board %i in script: %s", row, boardCount + 1, line);
+				fclose(f);
+				return 1;
+			}
+			b->cells[x][row] = c == 'x' ? 0 : (c == 'o' ? 1 : -1);
+		}
+		if(++row == b->n) {
+			row = -1;
+			boardCount++;
+		}
+	}
+	fclose(f);
+	if(row != -1 || boardCount == 0) {
+		fprintf(stderr, "Script has no boards or ends in the middle of one\n");
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Send a 200 response with body, after the configured delay */
+static void respond(connection_t *c, const char *body) {
+	char response[REQUEST_SIZE];
+	if(delayMs) usleep(delayMs * 1000);
+	int length = snprintf(response, sizeof(response), "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n\r\n%s", strlen(body), body);
+	if(write(c->fd, response, length) != length) fprintf(stderr, "Short write to client\n");
+}
+
+/**
+ * Answer a board poll: the current board if it is available, null if not */
+static void respondBoard(connection_t *c) {
+	if(current == boardCount || boards[current].ready > nowMs()) {
+		respond(c, "null");
+		return;
+	}
+	script_board_t *b = &boards[current];
+	char body[2048];
+	int length = sprintf(body, "{\"m\":%i,\"n\":%i,\"k\":%i,\"board\":[", b->m, b->n, b->k);
+	for(int x = 0; x < b->m; x++) {
+		body[length++] = '[';
+		for(int y = 0; y < b->n; y++) length += sprintf(body + length, "%s%i", y ? "," : "", b->cells[x][y]);
+		body[length++] = ']';
+		if(x < b->m - 1) body[length++] = ',';
+	}
+	sprintf(body + length, "]}");
+	if(!b->served) b->served = nowMs();
+	respond(c, body);
+}
+
+/**
+ * Get the integer value of name in a query string or form body, or def if it isn't there */
+static int formValue(const char *form, const char *name, int def) {
+	size_t length = strlen(name);
+	for(const char *p = form; p != NULL && *p; p = strchr(p, '&'), p = p ? p + 1 : NULL) {
+		if(!strncmp(p, name, length) && p[length] == '=') return strtol(p + length + 1, NULL, 10);
+	}
+	return def;
+}
+
+/**
+ * Handle one complete request. Returns nonzero if the connection should be closed */
+static int handleRequest(connection_t *c, char *request, const char *body, int oppTime) {
+	char method[8], path[512];
+	if(sscanf(request, "%7s %511s", method, path) != 2) return 1;
+	char *query = strchr(path, '?');
+	if(query != NULL) *query++ = 0;
+
+	if(!strcmp(path, "/api/board")) {
+		int wait = query != NULL ? formValue(query, "wait", 0) : 0;
+		if(wait > 0 && (current == boardCount || boards[current].ready > nowMs())) {
+			c->holding = 1;
+			c->holdUntil = nowMs() + wait;
+			return 0;
+		}
+		respondBoard(c);
+	} else if(!strcmp(path, "/api/move")) {
+		int x = formValue(body, "x", -1), y = formValue(body, "y", -1);
+		if(current == boardCount || !boards[current].served) {
+			fprintf(stderr, "Move (%i, %i) posted with no board to answer\n", x, y);
+		} else {
+			script_board_t *b = &boards[current];
+			b->posted = nowMs();
+			b->moveX = x;
+			b->moveY = y;
+			if(x < 0 || x >= b->m || y < 0 || y >= b->n || b->cells[x][y] != -1) fprintf(stderr, "Board %i: illegal move (%i, %i)\n", current + 1, x, y);
+			if(++current < boardCount) boards[current].ready = b->posted + oppTime;
+		}
+		respond(c, "{\"ok\":true}");
+	} else if(!strcmp(path, "/api/set_name")) {
+		respond(c, "{\"ok\":true}");
+	} else {
+		char response[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+		if(write(c->fd, response, sizeof(response) - 1) < 0) return 1;
+	}
+	return 0;
+}
+
+/**
+ * Handle every complete request buffered on a connection. Returns nonzero if it should be closed */
+static int handleBuffered(connection_t *c, int oppTime) {
+	while(!c->holding) {
+		c->request[c->length] = 0;
+		char *end = strstr(c->request, "\r\n\r\n");
+		if(end == NULL) return c->length == REQUEST_SIZE - 1;
+		size_t headerLength = end + 4 - c->request;
+		size_t bodyLength = 0;
+		char *contentLength = strcasestr(c->request, "Content-Length:");
+		if(contentLength != NULL && contentLength < end) bodyLength = strtoul(contentLength + 15, NULL, 10);
+		if(headerLength + bodyLength > REQUEST_SIZE - 1) return 1;
+		if(c->length < headerLength + bodyLength) return 0;
+
+		char body[REQUEST_SIZE];
+		memcpy(body, end + 4, bodyLength);
+		body[bodyLength] = 0;
+		*end = 0;
+		if(handleRequest(c, c->request, body, oppTime)) return 1;
+		memmove(c->request, c->request + headerLength + bodyLength, c->length - headerLength - bodyLength);
+		c->length -= headerLength + bodyLength;
+	}
+	return 0;
+}
+
+static int compareInt64(const void *a, const void *b) {
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * Print a latency row: percentiles of the count values (sorted in place) */
+static void printPercentiles(const char *name, int64_t *values, int count) {
+	qsort(values, count, sizeof(int64_t), compareInt64);
+	printf("%-14s %7lli %7lli %7lli %7lli %7lli\n", name, (long long)values[count / 2], (long long)values[count * 9 / 10],
+		(long long)values[count * 99 / 100], (long long)values[0], (long long)values[count - 1]);
+}
+
+int main(int argc, char **argv) {
+	int oppTime = 100;
+	int timeout = 30000;
+	int opt;
+	// stop at the first non-option, so mnk's options are left alone
+	while((opt = getopt(argc, argv, "+d:o:T:")) != -1) {
+		switch(opt) {
+			case 'd':
+				delayMs = strtol(optarg, NULL, 10);
+				break;
+			case 'o':
+				oppTime = strtol(optarg, NULL, 10);
+				break;
+			case 'T':
+				timeout = strtol(optarg, NULL, 10);
+				break;
+			default:
+				fprintf(stderr, "Usage: standin [-d delay_ms] [-o opponent_ms] [-T timeout_ms] script mnk_path [mnk options]\n");
+				return 1;
+		}
+	}
+	if(argc - optind < 2) {
+		fprintf(stderr, "Usage: standin [-d delay_ms] [-o opponent_ms] [-T timeout_ms] script mnk_path [mnk options]\n");
+		return 1;
+	}
+	if(loadScript(argv[optind])) return 1;
+	signal(SIGPIPE, SIG_IGN);
+
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	socklen_t addrLength = sizeof(addr);
+	if(listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) || listen(listener, MAX_CONNECTIONS)
+	|| getsockname(listener, (struct sockaddr *)&addr, &addrLength)) {
+		perror("Can't listen on 127.0.0.1");
+		return 1;
+	}
+	char url[64];
+	sprintf(url, "http://127.0.0.1:%i", ntohs(addr.sin_port));
+
+	// start mnk with its options, then the url and key
+	int mnkArgs = argc - optind - 1;
+	char **mnkArgv = calloc(mnkArgs + 3, sizeof(char *));
+	for(int i = 0; i < mnkArgs; i++) mnkArgv[i] = argv[optind + 1 + i];
+	mnkArgv[mnkArgs] = url;
+	mnkArgv[mnkArgs + 1] = KEY;
+	fflush(stdout);
+	pid_t mnk = fork();
+	if(mnk == 0) {
+		// keep the report readable: the client's output goes to stderr
+		dup2(STDERR_FILENO, STDOUT_FILENO);
+		execv(mnkArgv[0], mnkArgv);
+		perror("Can't run mnk");
+		_exit(1);
+	}
+	if(mnk < 0) {
+		perror("Can't fork");
+		return 1;
+	}
+
+	for(int i = 0; i < MAX_CONNECTIONS; i++) connections[i].fd = -1;
+	boards[0].ready = nowMs();
+	int64_t waitStart = nowMs();
+	int answered = 0;
+	int failed = 0;
+	while(current < boardCount) {
+		if(current != answered) {
+			answered = current;
+			waitStart = nowMs();
+		}
+		if(nowMs() - waitStart > timeout) {
+			fprintf(stderr, "No move for board %i after %ims\n", current + 1, timeout);
+			failed = 1;
+			break;
+		}
+		int status;
+		if(waitpid(mnk, &status, WNOHANG) == mnk) {
+			fprintf(stderr, "mnk exited before answering board %i\n", current + 1);
+			failed = 1;
+			mnk = -1;
+			break;
+		}
+
+		// answer held polls whose board is now available or whose wait ran out
+		int64_t now = nowMs();
+		int pollTimeout = 100;
+		for(int i = 0; i < MAX_CONNECTIONS; i++) {
+			connection_t *c = &connections[i];
+			if(c->fd < 0 || !c->holding) continue;
+			int available = current < boardCount && boards[current].ready <= now;
+			if(available || c->holdUntil <= now) {
+				c->holding = 0;
+				respondBoard(c);
+				if(handleBuffered(c, oppTime)) {
+					close(c->fd);
+					c->fd = -1;
+				}
+			} else {
+				int64_t wake = c->holdUntil;
+				if(current < boardCount && boards[current].ready < wake) wake = boards[current].ready;
+				if(wake - now < pollTimeout) pollTimeout = wake - now;
+			}
+		}
+
+		struct pollfd fds[MAX_CONNECTIONS + 1];
+		int which[MAX_CONNECTIONS + 1];
+		int count = 0;
+		fds[count].fd = listener;
+		fds[count].events = POLLIN;
+		which[count++] = -1;
+		for(int i = 0; i < MAX_CONNECTIONS; i++) {
+			if(connections[i].fd < 0) continue;
+			fds[count].fd = connections[i].fd;
+			fds[count].events = POLLIN;
+			which[count++] = i;
+		}
+		if(poll(fds, count, pollTimeout < 1 ? 1 : pollTimeout) < 0 && errno != EINTR) {
+			perror("poll");
+			failed = 1;
+			break;
+		}
+		for(int i = 0; i < count; i++) {
+			if(!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+			if(which[i] == -1) {
+				int fd = accept(listener, NULL, NULL);
+				if(fd < 0) continue;
+				int slot = 0;
+				while(slot < MAX_CONNECTIONS && connections[slot].fd >= 0) slot++;
+				if(slot == MAX_CONNECTIONS) {
+					close(fd);
+					continue;
+				}
+				int one = 1;
+				setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+				memset(&connections[slot], 0, sizeof(connection_t));
+				connections[slot].fd = fd;
+				continue;
+			}
+			connection_t *c = &connections[which[i]];
+			ssize_t got = read(c->fd, c->request + c->length, REQUEST_SIZE - 1 - c->length);
+			if(got <= 0) {
+				close(c->fd);
+				c->fd = -1;
+				continue;
+			}
+			c->length += got;
+			if(handleBuffered(c, oppTime)) {
+				close(c->fd);
+				c->fd = -1;
+			}
+		}
+	}
+
+	if(mnk > 0) {
+		kill(mnk, SIGTERM);
+		waitpid(mnk, NULL, 0);
+	}
+	for(int i = 0; i < MAX_CONNECTIONS; i++) {
+		if(connections[i].fd >= 0) close(connections[i].fd);
+	}
+	close(listener);
+	free(mnkArgv);
+
+	printf("board  poll_to_post_ms  ready_to_post_ms  move\n");
+	int64_t pollToPost[MAX_BOARDS], readyToPost[MAX_BOARDS];
+	for(int i = 0; i < current; i++) {
+		pollToPost[i] = boards[i].posted - boards[i].served;
+		readyToPost[i] = boards[i].posted - boards[i].ready;
+		printf("%5i  %15lli  %16lli  (%i, %i)\n", i + 1, (long long)pollToPost[i], (long long)readyToPost[i], boards[i].moveX, boards[i].moveY);
+	}
+	if(current > 0) {
+		printf("\nlatency_ms         p50     p90     p99     min     max\n");
+		printPercentiles("poll_to_post", pollToPost, current);
+		printPercentiles("ready_to_post", readyToPost, current);
+	}
+	return failed;
+}